@@ -0,0 +1,26 @@
+#ifndef __BatchJobs__
+#define __BatchJobs__
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Input/output pairs for the one-file tools (mkntuple, microrat). The
+// historical "input output" pair still works; otherwise inputs may be any
+// mix of file names and glob patterns, plus a manifest holding one
+// "input [output]" per line (# starts a comment). Inputs without an
+// explicit output are written to outdir under their own file name.
+class BatchJobs
+{
+  public:
+    BatchJobs( std::vector<std::string> inputs, std::string manifest, std::string outdir );
+
+    std::vector<std::pair<std::string, std::string> > jobs;
+
+  private:
+    void add( std::string input, std::string output );
+    void expand( std::string pattern );
+    std::string outdir;
+};
+
+#endif
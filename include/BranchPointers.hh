@@ -0,0 +1,31 @@
+#ifndef __BranchPointers__
+#define __BranchPointers__
+
+#include <memory>
+#include <vector>
+
+// Pointers for reading object branches into member objects.
+// TTree::SetBranchAddress wants the address of a pointer to a vector or
+// string, and it keeps that address until the branch is bound again.
+// hold() stores one such pointer and returns its address. A copy starts
+// out empty, and assigning leaves the target's own pointers alone: the
+// stored pointers refer to the original object's members.
+class BranchPointers
+{
+  public:
+    BranchPointers() {};
+    BranchPointers( const BranchPointers& ) {};
+    BranchPointers& operator=( const BranchPointers& ) { return *this; }
+
+    template<class T> T** hold( T* object )
+    {
+      std::shared_ptr<T*> pointer = std::make_shared<T*>( object );
+      pointers.push_back( pointer );
+      return pointer.get();
+    }
+
+  private:
+    std::vector<std::shared_ptr<void> > pointers;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __Classifiers__
+#define __Classifiers__
+
+#include <PMTGeometry.hh>
+#include <HitKernels.hh>
+#include <HitSummary.hh>
+#include <TVector3.h>
+#include <RAT/DS/EV.hh>
+#include <vector>
+
+class ChargeBalance
+{
+  public:
+    ChargeBalance( PMTGeometry* geometry, int usetype=1 );
+    double GetCB( RAT::DS::EV* ev );
+    // Same, from hits already staged for the vector kernels
+    double GetCB( const HitArrays& hits );
+    // Same, from the charge stats of a processed summary, without another
+    // pass over the hits
+    double GetCB( HitSummary& summary );
+  private:
+    PMTGeometry* geometry;
+    int pmtcount;
+    int usetype;
+};
+
+// beta_1 + 4 beta_4 of the hit directions seen from a vertex. The pair
+// sums are evaluated in O(N) through the addition theorem; with validate
+// set, every call is also checked against the O(N^2) pair loop.
+class Isotropy
+{
+  public:
+    Isotropy( PMTGeometry* geometry, int usetype=1 );
+    double GetIsotropy( RAT::DS::EV* ev, TVector3 position );
+    double pairwiseIsotropy();
+    double harmonicIsotropy();
+    void printValidation();
+
+    bool validate;
+    long validated;
+    double maxDeviation;
+  private:
+    PMTGeometry* geometry;
+    int pmtcount;
+    int usetype;
+    // Unit vectors from the vertex to each hit PMT, reused between events
+    std::vector<double> hx, hy, hz;
+};
+
+#endif
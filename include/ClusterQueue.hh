@@ -0,0 +1,73 @@
+#ifndef __ClusterQueue__
+#define __ClusterQueue__
+
+#include <TTree.h>
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Cluster ranges of T shared between worker threads and one writer.
+// Workers take clusters in order and hand back their Rows; the writer
+// collects them in entry order, so the output is the same as from the
+// serial loop. Workers wait when they run too far ahead of the writer,
+// bounding the rows held in memory.
+template<class Rows> class ClusterQueue
+{
+  public:
+    ClusterQueue( TTree* T, int nthreads ) :
+      next(0), written(0), ahead(2 * nthreads)
+    {
+      Long64_t entries = T->GetEntries();
+      TTree::TClusterIterator clusters = T->GetClusterIterator(0);
+      Long64_t start;
+      while( (start = clusters.Next()) < entries )
+        ranges.push_back( std::make_pair( start, std::min( clusters.GetNextEntry(), entries ) ) );
+    }
+
+    // Worker: index of the next cluster to fill, false when none is left
+    bool take( size_t& k )
+    {
+      std::unique_lock<std::mutex> guard( lock );
+      consumed.wait( guard, [this]{
+          return next >= ranges.size() || next < written + ahead; } );
+      if( next >= ranges.size() ) return false;
+      k = next++;
+      return true;
+    }
+    void finish( size_t k, Rows& rows )
+    {
+      {
+        std::lock_guard<std::mutex> guard( lock );
+        done[k] = std::move( rows );
+      }
+      ready.notify_all();
+    }
+    // Writer: the rows of cluster k, waiting for its worker
+    Rows collect( size_t k )
+    {
+      Rows rows;
+      {
+        std::unique_lock<std::mutex> guard( lock );
+        ready.wait( guard, [this, k]{ return done.count(k) > 0; } );
+        rows = std::move( done[k] );
+        done.erase(k);
+        written = k+1;
+      }
+      consumed.notify_all();
+      return rows;
+    }
+
+    std::vector<std::pair<Long64_t, Long64_t> > ranges;
+    size_t next;                  // next cluster to hand out
+    size_t written;               // clusters already taken by the writer
+    size_t ahead;                 // how far workers may run past the writer
+    std::map<size_t, Rows> done;
+    std::mutex lock;
+    std::condition_variable ready;     // a cluster finished
+    std::condition_variable consumed;  // the writer moved on
+};
+
+#endif
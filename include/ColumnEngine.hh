@@ -0,0 +1,211 @@
+#ifndef __ColumnEngine__
+#define __ColumnEngine__
+
+#include <Classifiers.hh>
+#include <HitSummary.hh>
+#include <PMTGeometry.hh>
+#include <DSBranchSelector.hh>
+#include <StreamingStats.hh>
+#include <NtupleOutput.hh>
+#include <TFile.h>
+#include <TTree.h>
+#include <TVector3.h>
+#include <RAT/DS/Root.hh>
+#include <RAT/DS/EV.hh>
+#include <RAT/DS/Run.hh>
+#include <boost/property_tree/ptree.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include <limits>
+#include <map>
+#include <cstring>
+
+class ColumnEngine;
+
+// Numeric view of a column value, used for the meta pedestal statistics
+inline double columnNumber( int v ) { return v; }
+inline double columnNumber( double v ) { return v; }
+inline double columnNumber( ULong64_t v ) { return v; }
+template<class T> double columnNumber( const T& ) { return std::numeric_limits<double>::quiet_NaN(); }
+
+// Column values as bytes, carrying the rows of worker threads to the
+// writer: plain values as they are, strings and vectors length first
+template<class T> void storeColumnValue( std::string& bytes, const T& v )
+{
+  bytes.append( reinterpret_cast<const char*>(&v), sizeof(T) );
+}
+template<class T> void loadColumnValue( const char*& p, T& v )
+{
+  memcpy( &v, p, sizeof(T) );
+  p += sizeof(T);
+}
+inline void storeColumnValue( std::string& bytes, const std::string& v )
+{
+  storeColumnValue( bytes, v.size() );
+  bytes.append( v );
+}
+inline void loadColumnValue( const char*& p, std::string& v )
+{
+  size_t n;
+  loadColumnValue( p, n );
+  v.assign( p, n );
+  p += n;
+}
+template<class T> void storeColumnValue( std::string& bytes, const std::vector<T>& v )
+{
+  storeColumnValue( bytes, v.size() );
+  bytes.append( reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T) );
+}
+template<class T> void loadColumnValue( const char*& p, std::vector<T>& v )
+{
+  size_t n;
+  loadColumnValue( p, n );
+  v.resize( n );
+  memcpy( v.data(), p, n * sizeof(T) );
+  p += n * sizeof(T);
+}
+
+// Rows of one T cluster filled by a worker engine, see ColumnEngine::fill
+class ColumnRows
+{
+  public:
+    ColumnRows() : count(0) {};
+    std::string bytes;
+    size_t count;
+};
+
+// One output branch. Extractors read their inputs through the engine,
+// which evaluates each input at most once per EV and only when asked.
+class Column
+{
+  public:
+    Column( std::string name ) : name(name) {};
+    virtual ~Column() {};
+    virtual void branch( NtupleOutput* output ) = 0;
+    virtual void fill( ColumnEngine& engine ) = 0;
+    virtual double number() = 0;
+    // Append the current value to bytes / read it back, advancing p
+    virtual void store( std::string& bytes ) = 0;
+    virtual void load( const char*& p ) = 0;
+    std::string name;
+};
+
+template<class T> class ValueColumn : public Column
+{
+  public:
+    typedef std::function<void(ColumnEngine&, T&)> Getter;
+    ValueColumn( std::string name, Getter get ) : Column(name), get(get), value() {};
+    void branch( NtupleOutput* output ) { output->Branch( name.c_str(), &value ); }
+    void fill( ColumnEngine& engine ) { get( engine, value ); }
+    double number() { return columnNumber( value ); }
+    void store( std::string& bytes ) { storeColumnValue( bytes, value ); }
+    void load( const char*& p ) { loadColumnValue( p, value ); }
+    Getter get;
+    T value;
+};
+
+// Builds a column from its config entry; may register engine inputs
+typedef std::function<Column*(std::string name, const boost::property_tree::ptree& spec,
+    ColumnEngine& engine)> ColumnFactory;
+
+// Config driven ntuple writer. The config is a json object with a
+// "columns" list; each entry has a "name" and an "extractor" from the
+// registry (defaulting to the standard column of the same name) plus the
+// extractor's own parameters. The optional "pedestal" key names the
+// column whose mean and spread go to the meta tree. Outputs are TTrees or
+// RNTuples, filled serially or by worker engines built from the same
+// config, one per thread. Rows come from the T tree of an input file, or
+// from events handed in one by one, as the merger does.
+class ColumnEngine
+{
+  public:
+    ColumnEngine( const boost::property_tree::ptree& config );
+    ~ColumnEngine();
+    static ColumnEngine* fromFile( std::string fname );
+    static ColumnEngine* fromString( std::string json );
+    // Every standard column, in schema order: the mkntuple ntuple
+    static ColumnEngine* standard();
+    static std::map<std::string, ColumnFactory>& registry();
+
+    // Whole input file to one output file with output and meta trees;
+    // rows in the same order and the same meta for any nthreads
+    void processFile( std::string iname, std::string oname, bool rntuple=false, int nthreads=1 );
+    // Attach to the T tree of a new input; the geometry and classifiers
+    // are rebuilt only when its PMTInfo differs from the last file's
+    void open( TFile* tfile, TTree* T, bool report=true );
+    // Events without a T tree take their geometry from the PMTInfo
+    void open( RAT::DS::PMTInfo* pmtinfo );
+    void NewBranches( NtupleOutput* output );
+    // Read one T entry and fill one row per EV
+    void fill( Long64_t entry, NtupleOutput* output );
+    // Same, the rows kept as bytes for fillRows of another engine
+    void fill( Long64_t entry, ColumnRows& rows );
+    // One row per EV of an event already in memory
+    void fill( RAT::DS::Root* event, const std::string& name, NtupleOutput* output );
+    void fillRows( const ColumnRows& rows, NtupleOutput* output );
+    void fillMeta( TTree* meta, double livetime );
+    // Isotropy checks of the current file, see Isotropy::validate; the
+    // counts of the worker engines are merged in by fillThreaded
+    void printValidation();
+    void mergeValidation( ColumnEngine& other );
+    bool validate;
+
+    // Inputs for the extractors, each evaluated on first use. The event
+    // and its component name are the last read from T, or the ones handed
+    // to fill
+    RAT::DS::Root* ds;
+    const std::string* dsname;
+    RAT::DS::EV* ev;
+    int subev;
+    ULong64_t mctime();
+    const std::vector<double>& mc( const std::string& field );
+    const std::vector<Int_t>& pdg();
+    const TVector3& pathPosition();
+    const TVector3& pathDirection();
+    const TVector3& centroid();
+    double qreco( int axis );
+    HitSummary* hits();
+    ChargeBalance* chargeBalance( int type );
+    Isotropy* isotropy( int type );
+    // Registration, called by the factories at construction
+    int addWindow( std::string name, double minT, double maxT, int type );
+    bool needGeometry;
+    bool needQReco;
+    int parts;      // DSBranchSelector parts the columns read
+
+    std::vector<Column*> columns;
+    StreamingStats pedestals;
+    Column* pedestalColumn;
+    boost::property_tree::ptree config;
+
+  private:
+    void fillThreaded( std::string iname, TTree* T, NtupleOutput* output, int nthreads );
+    void evaluate( int sub );
+    void fillRow( NtupleOutput* output );
+    void newEvent();
+    void newEV( int sub );
+    void buildGeometry( RAT::DS::PMTInfo* pmtinfo );
+
+    TTree* T;
+    // Bound to the ds and name branches of T
+    RAT::DS::Root* readDS;
+    std::string* readName;
+    RAT::DS::Run* run;
+    PMTGeometry* geometry;
+    HitSummary* summary;
+    std::vector<HitWindow> windows;
+    std::map<int, ChargeBalance*> balances;
+    std::map<int, Isotropy*> isotropies;
+    // Per event MC particle information
+    bool mcReady;
+    ULong64_t mcT;
+    std::vector<Int_t> pdgcodes;
+    std::map<std::string, std::vector<double> > mcFields;
+    // Per EV
+    bool pathReady, centroidReady, hitsReady;
+    TVector3 pathPos, pathDir, centroidPos;
+    std::vector<double> *qrecoX, *qrecoY, *qrecoZ;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __DSBranchSelector__
+#define __DSBranchSelector__
+
+#include <TTree.h>
+#include <string>
+
+// Reads only the parts of the split ds branch a tool declares. Everything
+// under ds is switched off with SetBranchStatus, then the requested parts
+// are switched back on; other top level branches (name, Q_Reco_*) stay
+// on. Works on a TChain as well, the status is applied to each file.
+class DSBranchSelector
+{
+  public:
+    enum Part
+    {
+      EV          = 1,   // EV scalars: id, trigger time, delta t, charge
+      PMTs        = 2,   // EV hit list
+      PathFit     = 4,
+      Centroid    = 8,
+      MC          = 16,  // MC scalars: UTC, counts
+      MCParticles = 32,
+      MCPMTs      = 64,  // MC PMTs and their photons
+      Everything  = 127
+    };
+
+    DSBranchSelector( TTree* T, int parts, std::string dsbranch="ds" );
+    // Turn everything back on, e.g. to copy kept events whole
+    void readAll();
+    // Print the on-disk bytes of the branches read and skipped
+    void report();
+
+    TTree* T;
+    int parts;
+    std::string dsbranch;
+    Long64_t bytesRead;
+    Long64_t bytesSkipped;
+
+  private:
+    void count( TTree* tree, TBranch* branch );
+};
+
+#endif
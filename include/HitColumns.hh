@@ -0,0 +1,66 @@
+#ifndef __HitColumns__
+#define __HitColumns__
+
+#include <NtupleOutput.hh>
+#include <BranchPointers.hh>
+#include <RAT/DS/EV.hh>
+#include <vector>
+#include <cstddef>
+
+// IEEE binary16 storage of a float, rounded to nearest even. 11
+// significant bits: hit times near 500 ns keep 0.25 ns, charges keep
+// three digits.
+UShort_t floatToHalf( float x );
+float halfToFloat( UShort_t h );
+
+// Hits of one EV, pointing into the columns of a HitColumns
+class HitSpan
+{
+  public:
+    HitSpan( const UShort_t* pmt, const UShort_t* time, const UShort_t* charge, size_t count ) :
+      pmt(pmt), time(time), charge(charge), count(count) {};
+    size_t size() const { return count; }
+    int id( size_t i ) const { return pmt[i]; }
+    float t( size_t i ) const { return halfToFloat( time[i] ); }
+    float q( size_t i ) const { return halfToFloat( charge[i] ); }
+
+    const UShort_t* pmt;
+    const UShort_t* time;
+    const UShort_t* charge;
+    size_t count;
+};
+
+// Hit lists of every EV of an event as packed columns: PMT ID, time and
+// charge of all hits back to back, and the start of each EV's hits in
+// offset (one entry per EV plus the end). Written next to the MicroDS
+// summaries by microrat --hits.
+class HitColumns
+{
+  public:
+    HitColumns();
+
+    void cleardata();
+    // Append the PMT hits of ev as the next EV; exits on IDs above 65535
+    void addEV( RAT::DS::EV* ev );
+    void NewBranches( NtupleOutput* t );
+    // The columns are read into this object; bind again after copying it
+    void SetBranches( TTree* t );
+    void SetBranches( NtupleReader* t );
+    int evcount() const { return offset.size() - 1; }
+    // No copies, valid until the next entry is read
+    HitSpan ev( int sub ) const
+    {
+      return HitSpan( pmt.data() + offset[sub], time.data() + offset[sub],
+          charge.data() + offset[sub], offset[sub+1] - offset[sub] );
+    }
+
+    std::vector<UShort_t> pmt;
+    std::vector<UShort_t> time;     // binary16, ns
+    std::vector<UShort_t> charge;   // binary16
+    std::vector<UInt_t> offset;
+
+  private:
+    BranchPointers pointers;
+};
+
+#endif
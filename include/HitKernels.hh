@@ -0,0 +1,63 @@
+#ifndef __HitKernels__
+#define __HitKernels__
+
+#include <RAT/DS/EV.hh>
+#include <vector>
+#include <string>
+
+// Hits of one EV staged in structure-of-arrays form, capacity is reused
+// from event to event
+class HitArrays
+{
+  public:
+    void stage( RAT::DS::EV* ev, const std::vector<int>& typeById );
+    int size() const { return time.size(); }
+
+    std::vector<float> time;
+    std::vector<float> charge;
+    std::vector<int> id;
+    std::vector<int> type;
+};
+
+class ChargeStats
+{
+  public:
+    double sum;
+    double sumsq;
+    float max;      // 0 when no hit passes, as in the original loops
+};
+
+// Hits of the given type with minT < time < maxT, counted by summarize
+class WindowCut
+{
+  public:
+    float minT;
+    float maxT;
+    int type;
+};
+
+// Per-hit kernels over HitArrays. Each has a scalar reference version and
+// SSE4.1, AVX2 and AVX-512 versions; the widest one the CPU supports is
+// picked on first use. Setting HITKERNELS_ISA=scalar|sse4.1|avx2|avx512f
+// in the environment forces a variant (never one the CPU lacks).
+namespace HitKernels
+{
+  // Types the vector versions of summarize keep accumulators for; more
+  // types are summarized by the scalar version
+  const int maxTypes = 16;
+  // Every window count and the charge stats of the types
+  // 0 .. stats.size()-1, in a single pass over the hits; counts has one
+  // entry per window
+  void summarize( const HitArrays& hits, const std::vector<WindowCut>& windows,
+      std::vector<int>& counts, std::vector<ChargeStats>& stats );
+  // Hits of the given type with minT < time < maxT
+  int countWindow( const HitArrays& hits, float minT, float maxT, int type );
+  // Charge sum, sum of squares and maximum over hits of the given type
+  ChargeStats chargeStats( const HitArrays& hits, int type );
+  // Name of the variant in use
+  const char* isa();
+  // Use exactly this variant, for cross-checks; false when the CPU lacks it
+  bool select( const std::string& name );
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __HitSummary__
+#define __HitSummary__
+
+#include <PMTGeometry.hh>
+#include <HitKernels.hh>
+#include <RAT/DS/EV.hh>
+#include <string>
+#include <vector>
+
+// Hit count in (minT, maxT) relative to the trigger, for one PMT type
+class HitWindow
+{
+  public:
+    HitWindow( std::string name, double minT, double maxT, int type ) :
+      name(name), minT(minT), maxT(maxT), type(type) {};
+    std::string name;
+    double minT;
+    double maxT;
+    int type;
+};
+
+// Every per-EV hit quantity of the ntuple from one staging of the hit list:
+// the count of each window in the table plus the charge sum and maximum
+// per PMT type, all filled by a single HitKernels::summarize pass.
+class HitSummary
+{
+  public:
+    HitSummary( PMTGeometry* geometry );
+
+    // Returns the index of the window in counts
+    int addWindow( std::string name, double minT, double maxT, int type=1 );
+    void process( RAT::DS::EV* ev );
+    double charge( int type );
+    double maxCharge( int type );
+    // Zeros for types without PMTs
+    ChargeStats typeStats( int type );
+
+    std::vector<HitWindow> windows;
+    std::vector<int> counts;
+    // Hits of the last processed EV, for other per-hit consumers
+    HitArrays staged;
+
+  private:
+    PMTGeometry* geometry;
+    std::vector<WindowCut> cuts;
+    std::vector<ChargeStats> stats;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __MergedIndex__
+#define __MergedIndex__
+
+#include <TFile.h>
+#include <TTree.h>
+#include <RAT/DS/Root.hh>
+#include <string>
+#include <vector>
+
+// Reader for the time index written next to T by the merger. The index is
+// loaded once; window queries are binary searches and only the matching
+// T entries are ever read.
+class MergedIndex
+{
+  public:
+    MergedIndex( std::string fname );
+    ~MergedIndex();
+
+    // Index rows with nanotime in [tmin, tmax), times in seconds
+    std::pair<size_t, size_t> window( double tmin, double tmax );
+    // T entries of those rows, each entry once
+    std::vector<Long64_t> entries( double tmin, double tmax );
+    // Read the event of an index row from T
+    RAT::DS::Root* load( size_t row );
+
+    std::string fname;
+    std::vector<ULong64_t> nanotime;
+    std::vector<Long64_t> entry;
+    std::vector<int> component;
+    std::vector<double> x, y, z;
+
+  private:
+    TFile* tfile;
+    TTree* ttree;
+    RAT::DS::Root* ds;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <MergerConfig.hh>
 #include <TFile.h>
 #include <TTree.h>
+#include <TTreeFormula.h>
 #include <TRandom3.h>
 #include <RAT/DS/Root.hh>
 #include <RAT/DS/Run.hh>
@@ -13,9 +14,48 @@
 #include <vector>
 #include <map>
 #include <utility>
+#include <tuple>
 
 class MergerTChain;
 class MergerTFile;
+class MergerEventCache;
+class MergerPrefetcher;
+
+// One sampled event before the coincidence selection. The file and event
+// are kept as uniforms so the chain resolves them against its own files.
+// ukeep decides rate-scan thinning: kept at scale s when ukeep < s, so
+// every target and scale sees the same, nested subsets.
+class RawPick
+{
+  public:
+    double time;
+    int component;
+    double ufile;
+    double uevt;
+    double ukeep;
+};
+
+// Compact summary of an isolated event in coincidence-only mode
+class SingleRecord
+{
+  public:
+    double time;
+    int component;
+    double x, y, z;
+};
+
+// One event of the merged timeline, as handed out by nextMergedEvent
+class MergedEvent
+{
+  public:
+    double time;
+    int component;
+    std::string name;
+    int file_index;
+    int evt_index;
+    double x, y, z;
+    RAT::DS::Root* ds;
+};
 
 class MergerChainFactory
 {
@@ -29,6 +69,15 @@ class MergerChainFactory
     MergerConfig* config;
     MergerTChain* nextChain;
     std::map<double, int> timeComponentMap;
+    std::vector<RawPick> rawTimeline;
+    // Set while replayTimeline selects; its picks were prefetched as sampled
+    bool replaying;
+    double rateScale;
+    // Coincidence-only output: isolated events become SingleRecords
+    bool coincidenceOnly;
+    std::vector<SingleRecord> singles;
+    std::vector<Long64_t> sampledCount;
+    std::vector<Long64_t> writtenCount;
     std::pair<double, int> bufferTC;
     double bufferTimePrev;
     double bufferXPrev;
@@ -48,9 +97,71 @@ class MergerChainFactory
 
     std::string LastFileName;
 
+    // Merged output state
+    std::map<double, int>::iterator mergeCursor;
+    TFile* outFile;
+    TTree* outTree;
+    RAT::DS::Root* outDS;
+    std::string outComponent;
+    std::string outName;
+    double outWeight;
+    // Reuse mode: (component, file, event) -> multiplicity and T entry,
+    // plus the occurrences sidecar tree of (time, entry)
+    typedef std::tuple<int, int, int> SourceKey;
+    std::map<SourceKey, Long64_t> reuseCount;
+    std::map<SourceKey, Long64_t> reuseEntry;
+    TTree* outOccurrences;
+    double occurrenceTime;
+    Long64_t occurrenceEntry;
+    // Time-ordered index of T, see MergedIndex
+    TTree* outIndex;
+    ULong64_t indexTime;
+    Long64_t indexEntry;
+    int indexComponent;
+    double indexX, indexY, indexZ;
+
     // Member functions
     double nextEvent();
+    RawPick samplePick();
+    double selectPick(RawPick& pick);
+    // Decide the event still buffered once the sampling is over
+    void flushSelection();
+    // Write (into the chains), summarize or drop the buffered event
+    void decideBuffer(bool coincident);
+    void resetSelection();
+    void resetCounts();
     void buildNewFile(std::string fname);
+    // Rate scan: nextRawEvent at the highest rate, then buildRateScan
+    // writes one file per scale from a single read of the inputs.
+    // A target sweep copies one factory's rawTimeline into the others and
+    // replays it with keep = 1; sameSampling checks that the timeline
+    // holds for them, it is drawn from the first target's rates.
+    double nextRawEvent();
+    void replayTimeline(double keep);
+    bool sameSampling(const MergerChainFactory& other) const;
+    // Queue the source event of pick with the prefetcher, if one is set
+    void prefetchPick(const RawPick& pick);
+    void buildRateScan(std::vector<double> scales, std::vector<std::string> fnames);
+    // Pull-based access: buildEvents, then nextMergedEvent until false,
+    // then finishDataset. Each event may be teed to a RAT file through
+    // openNewFile / fillNewFile / closeNewFile.
+    void buildEvents();
+    bool nextMergedEvent(MergedEvent& evt);
+    void finishDataset();
+    void writeNewFile(std::string fname);
+    void openNewFile(std::string fname);
+    void fillNewFile(MergedEvent& evt);
+    void closeNewFile();
+    void writeSingles();
+    void countReuse();
+    // Dry run: resources of the sampled timeline, without reading events.
+    // baseline is the resident size before sampling, see residentBytes
+    void printEstimate(double samplingSeconds, double baseline);
+    // Current resident size of this process
+    static double residentBytes();
+    RAT::DS::Run* getRun();
+    void setCache(MergerEventCache* cache);
+    void setPrefetcher(MergerPrefetcher* prefetcher);
     std::vector<std::string> listDir(std::string directory);
 };
 
@@ -58,7 +169,9 @@ class MergerTChain
 {
   public:
     MergerTChain( std::string dstree, std::string dsbranch, std::string name, 
-        std::vector<std::string> directory, double rate, bool is_single, TRandom3* rndm );
+        std::vector<std::string> directory, double rate, bool is_single, TRandom3* rndm,
+        std::string selection="",
+        std::map<std::string, std::string> aliases=std::map<std::string, std::string>() );
     ~MergerTChain();
 
     std::string dstree;
@@ -66,11 +179,30 @@ class MergerTChain
     std::string name;
     std::vector<std::string> directory;
     bool is_single;
+    // Scaled and thinned in rate-scan mode
+    bool scan;
+    // Distinct events written once, see MergerChainFactory::countReuse
+    bool reuse;
     double rate;
     double efficiency;
+    std::string selection;
+    std::map<std::string, std::string> aliases;
     // Entries is the number of files
     int entries;
     int counter;
+    // Events dropped by the component selection
+    int rejected;
+    // Bytes read by eventBuilder against the bytes of the requested events
+    Long64_t bytesRead;
+    Long64_t bytesNeeded;
+    // Average event size on disk and in memory, read time, and size and
+    // time once written to a merged file, see profile
+    bool profiled;
+    double eventZipBytes;
+    double eventTotBytes;
+    double secondsPerEvent;
+    double eventWriteBytes;
+    double secondsPerWrite;
     // Current file and event index
     int file_index;
     int evt_index;
@@ -80,6 +212,8 @@ class MergerTChain
     std::vector<int> fileStamps;
     std::vector<int> evtStamps;
     TRandom3* rndm;
+    // Optional readahead of each event as soon as it is sampled
+    MergerPrefetcher* prefetcher;
 
     RAT::DS::Root* ds;
     std::vector<RAT::DS::Root> dsevents;
@@ -98,26 +232,46 @@ class MergerTChain
     void setupHeader();
     void setupDB();
     void getRandomEvent();
+    void pickEvent(double ufile, double uevt);
+    // File and entry a pick resolves to, as pickEvent would choose them
+    void locateEvent(double ufile, double uevt, int& findex, int& evindex);
+    void prefetchEvent(double ufile, double uevt);
+    void prefetchEntry(int findex, int evindex);
+    void setCache(MergerEventCache* cache);
+    void profile();
 };
 
 class MergerTFile
 {
   public:
-    MergerTFile( std::string dstree, std::string dsbranch, std::string fname, TRandom3* rndm );
+    MergerTFile( std::string dstree, std::string dsbranch, std::string fname, TRandom3* rndm,
+        std::string selection="",
+        std::map<std::string, std::string> aliases=std::map<std::string, std::string>() );
     ~MergerTFile();
 
     std::string dstree;
     std::string dsbranch;
     std::string fname;
     TRandom3* rndm;
+    std::string selection;
+    std::map<std::string, std::string> aliases;
 
     TFile* tfile;
     TTree* ttree;
     RAT::DS::Root* ds;
+    TTreeFormula* cut;
+    // Optional node-local cache shared between merger processes
+    MergerEventCache* cache;
     int entries;
+    int rejected;
+    Long64_t bytesRead;
+    Long64_t bytesNeeded;
 
     std::vector<RAT::DS::Root> getSubset(std::vector<int>);
-    bool checkEvent();
+    // Cache for reading every branch of events, or with full false only
+    // what the selection reads
+    std::vector< std::pair<Long64_t, Long64_t> > planClusters(std::vector<int>& events, bool full);
+    bool checkEvent(int entry);
     void open();
     void close();
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 class MCComponent;
 
@@ -23,13 +24,20 @@ class MergerConfig
     std::string dsbranch;
     double deltat;
     double deltar;
+    // Rate scale factors of a rate scan (empty for a normal merge)
+    std::vector<double> rateScan;
+    // Shorthand names usable in component selections, resolved as TTree
+    // aliases on the split ds branch (overridable in the header block)
+    std::map<std::string, std::string> aliases;
 };
 
 class MCComponent
 {
   public:
-    MCComponent( std::string _name, std::string _dir, double _rate, std::string classify ) :
-      name(_name), dir(_dir), rate(_rate) {
+    MCComponent( std::string _name, std::string _dir, double _rate, std::string classify,
+        std::string _selection="", bool _scan=true, bool _reuse=false ) :
+      name(_name), dir(_dir), rate(_rate), selection(_selection), scan(_scan),
+      reuse(_reuse) {
         if( classify == "single" )
           is_single = true;
         else
@@ -40,6 +48,12 @@ class MCComponent
     std::string dir;
     double rate;
     bool is_single;
+    // Optional cut evaluated before the full event is read
+    std::string selection;
+    // Whether a rate scan scales this component
+    bool scan;
+    // Write each distinct source event once with its multiplicity
+    bool reuse;
 };
 
 #endif
@@ -0,0 +1,84 @@
+#ifndef __MergerEventCache__
+#define __MergerEventCache__
+
+#include <RAT/DS/Root.hh>
+#include <string>
+#include <cstdint>
+#include <pthread.h>
+
+// Node-local cache of serialized RAT events in POSIX shared memory, keyed
+// by (file, entry). Every merger process on a node that opens the same
+// segment name shares it; readers stream a record straight from the
+// segment under the lock. Records live in a ring buffer, so once the size
+// budget is used up the oldest events are evicted first.
+//
+// The lock is a robust mutex: when a process dies holding it, the next
+// one to lock starts the cache over empty. A process that still cannot
+// get the lock within a few seconds stops using the cache.
+//
+// The segment outlives the processes, remove it with
+//   rm /dev/shm/<name>
+class MergerEventCache
+{
+  public:
+    MergerEventCache( std::string name, uint64_t budget );
+    ~MergerEventCache();
+
+    // True (and ds filled) if the event is cached
+    bool get( const std::string& fname, int entry, RAT::DS::Root* ds );
+    void put( const std::string& fname, int entry, RAT::DS::Root* ds );
+    void print();
+
+    std::string name;
+    uint64_t budget;
+    long hits;
+    long misses;
+    long stored;
+    bool disabled;
+
+  private:
+    struct Header
+    {
+      uint64_t magic;
+      pthread_mutex_t lock;
+      uint64_t capacity;  // bytes in the record ring
+      uint64_t nslots;    // power of two
+      uint64_t head;      // next write position (monotonic)
+      uint64_t tail;      // oldest live position (monotonic)
+      uint64_t tombstones;
+    };
+    struct Slot
+    {
+      uint64_t key;
+      uint64_t position;
+      uint64_t state;
+    };
+    // Followed by the file name, then the serialized event
+    struct Record
+    {
+      uint64_t key;       // 0 marks padding up to the end of the ring
+      uint64_t size;      // including this header and the file name
+      int64_t entry;
+      uint32_t namelen;
+      uint32_t payload;
+    };
+
+    uint64_t makeKey( const std::string& fname, int entry );
+    Slot* findSlot( uint64_t key );
+    void insertSlot( uint64_t key, uint64_t position );
+    // Slot table from the records in the ring, dropping the tombstones
+    void rebuildSlots();
+    // Empty cache, after a peer died holding the lock
+    void reset();
+    void evictOldest();
+    bool lock();
+    void unlock();
+
+    int fd;
+    uint64_t mapsize;
+    Header* header;
+    Slot* slots;
+    char* ring;
+};
+
+#endif
@@ -19,7 +19,18 @@ class MergerParser
     double time;
     bool verbose;
     bool superverbose;
+    bool ntuple;
+    bool tee;
+    bool coincidenceOnly;
+    bool dryRun;
     std::string subdir;
+    // Every target of a sweep, subdir is the first of them
+    std::vector<std::string> subdirs;
+    // Shared-memory event cache, disabled when shmCache is empty
+    std::string shmCache;
+    double shmSize;
+    // Background prefetch threads, 0 disables
+    int prefetch;
   private:
     void help();
     void setDefaultParams();
@@ -0,0 +1,70 @@
+#ifndef __MergerPrefetcher__
+#define __MergerPrefetcher__
+
+#include <TTree.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// Background readahead of source events while the timeline is still being
+// sampled. Events are queued as the merger keeps them, or as they are
+// sampled when the selection only runs on a replay (rate scans, sweeps);
+// worker threads look up the baskets holding each (file, entry) and ask
+// the kernel to read them (posix_fadvise WILLNEED), so by the time
+// eventBuilder opens the file the bytes are already in the page cache.
+class MergerPrefetcher
+{
+  public:
+    MergerPrefetcher( int nthreads, std::string dstree );
+    ~MergerPrefetcher();
+
+    void request( const std::string& fname, int entry );
+    // Block until every queued request has been handled
+    void drain();
+    void print();
+
+    std::string dstree;
+    std::atomic<long> requested;
+    std::atomic<long> baskets;
+    std::atomic<long> bytes;
+
+  private:
+    // Byte range of one basket and the entries it holds
+    struct BasketRange
+    {
+      Long64_t first;
+      Long64_t last;
+      Long64_t seek;
+      Int_t size;
+    };
+    struct FileLayout
+    {
+      bool ready;
+      std::vector<BasketRange> ranges;
+      std::set<Long64_t> issued;
+      std::mutex lock;
+    };
+
+    void work();
+    FileLayout* layout( const std::string& fname );
+    void addBaskets( TBranch* branch, Long64_t entries, std::vector<BasketRange>& ranges );
+    void prefetch( const std::string& fname, FileLayout* fl, int entry );
+
+    std::vector<std::thread> workers;
+    std::deque< std::pair<std::string, int> > queue;
+    std::map<std::string, FileLayout*> layouts;
+    std::mutex queueLock;
+    std::mutex layoutLock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    int busy;
+    bool stop;
+};
+
+#endif
@@ -3,49 +3,68 @@
 
 #include <TTimeStamp.h>
 #include <TTree.h>
+#include <NtupleOutput.hh>
+#include <BranchPointers.hh>
 #include <vector>
 
+// One event reduced to per-particle and per-EV vectors. The vectors are
+// plain members: cleardata keeps their capacity, and copyTo assigns into
+// an existing MicroDS, so refilling or copying events stops allocating
+// once the largest event has been seen. Branch addresses point into the
+// object, bind again after moving or copying it.
 class MicroDS
 {
   public:
     MicroDS();
+    MicroDS( const MicroDS& other ) = default;
+    MicroDS( MicroDS&& other ) = default;
+    MicroDS& operator=( const MicroDS& other ) = default;
+    MicroDS& operator=( MicroDS&& other ) = default;
     ~MicroDS();
 
     void cleardata();
+    // Capacity for the particles and EVs of a typical event
+    void reserve( size_t particles, size_t evs );
     void NewBranches(TTree*);
+    void NewBranches(NtupleOutput*);
     void SetBranches(TTree*);
-    MicroDS clone();
+    MicroDS clone() const;
+    // Copy into other, reusing its capacity
+    void copyTo( MicroDS& other ) const;
 
     TTimeStamp mcT;
     // MCParticles
     int mcpcount;
-    std::vector<Int_t>* pdgcodes;
-    std::vector<double>* mcKEnergies;
-    std::vector<double>* mcPosx;
-    std::vector<double>* mcPosy;
-    std::vector<double>* mcPosz;
-    std::vector<double>* mcDirx;
-    std::vector<double>* mcDiry;
-    std::vector<double>* mcDirz;
+    std::vector<Int_t> pdgcodes;
+    std::vector<double> mcKEnergies;
+    std::vector<double> mcPosx;
+    std::vector<double> mcPosy;
+    std::vector<double> mcPosz;
+    std::vector<double> mcDirx;
+    std::vector<double> mcDiry;
+    std::vector<double> mcDirz;
 
     // Reconstructed variables / ev
     int evcount;
-    std::vector<int>* pedestal;   // (-150, -50)
-    std::vector<int>* n100;       // (-20, 80)
-    std::vector<int>* n400;       // (-50, 350)
-    std::vector<int>* nReal;      // (-200, 600) Excluding noise hits
+    std::vector<int> pedestal;   // (-150, -50)
+    std::vector<int> n100;       // (-20, 80)
+    std::vector<int> n400;       // (-50, 350)
+    std::vector<int> nReal;      // (-200, 600) Excluding noise hits
     // Position
-    std::vector<double>* x;
-    std::vector<double>* y;
-    std::vector<double>* z;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
     // Direction
-    std::vector<double>* u;
-    std::vector<double>* v;
-    std::vector<double>* w;
+    std::vector<double> u;
+    std::vector<double> v;
+    std::vector<double> w;
     // EV Info
-    std::vector<int>*        subev;
-    std::vector<double>* triggertime;
+    std::vector<int>    subev;
+    std::vector<double> triggertime;
 
+  private:
+    // Vector branches are read through these, see SetBranches
+    BranchPointers pointers;
 };
 
 #endif
@@ -0,0 +1,30 @@
+#ifndef __NtupleCache__
+#define __NtupleCache__
+
+#include <string>
+
+// Content fingerprint of an ntuple job: input size and mtime, a checksum
+// of the input T tree (entries and the basket table of every branch and
+// sub-branch), the tool version and the column config. Outputs carry it
+// as a TNamed, so a campaign rerun only needs to process new or changed
+// inputs. The checksum reads no event data: a rewrite that leaves every
+// basket at the same offset with the same stored size, such as new values
+// in uncompressed fixed-size branches, is only caught by size and mtime.
+class NtupleCache
+{
+  public:
+    // config is anything selecting the columns or the output format
+    NtupleCache( std::string version, std::string config );
+
+    // Empty when the input cannot be read; such jobs always run
+    std::string fingerprint( std::string iname );
+    // oname exists, is readable and was made from the same fingerprint
+    bool upToDate( std::string oname, const std::string& fp );
+    // Store fp in the finished output
+    void record( std::string oname, const std::string& fp );
+
+    std::string version;
+    std::string configHash;
+};
+
+#endif
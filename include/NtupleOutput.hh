@@ -0,0 +1,124 @@
+#ifndef __NtupleOutput__
+#define __NtupleOutput__
+
+#include <RVersion.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <BranchPointers.hh>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+// RNTuple reader and writer are usable from ROOT 6.32, and left the
+// Experimental namespace in 6.36
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,32,0)
+#define NTUPLE_HAS_RNTUPLE
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#include <ROOT/RNTupleReader.hxx>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,36,0)
+namespace RNTupleAPI = ROOT;
+#else
+namespace RNTupleAPI = ROOT::Experimental;
+#endif
+#endif
+
+// RNTuple field type for a branch type; ULong64_t is unsigned long long,
+// which RNTuple only knows as std::uint64_t
+template<class T> struct RNTupleField { typedef T type; };
+template<> struct RNTupleField<ULong64_t> { typedef std::uint64_t type; };
+
+// Destination of the flat ntuple rows: a TTree, or an RNTuple written into
+// the same file. Offers the two TTree calls the makers use, Branch and
+// Fill. RNTuple fields are bound to the same addresses as the branches;
+// the writer is created on the first Fill, once every field is known, or
+// by Close, so an input without rows still gives an empty RNTuple.
+class NtupleOutput
+{
+  public:
+    NtupleOutput( TTree* tree );
+    // RNTuple called name in file; exits when ROOT is too old
+    NtupleOutput( std::string name, TFile* file );
+    ~NtupleOutput();
+    static bool rntupleSupported();
+
+    template<class T> void Branch( const char* name, T* address )
+    {
+      if( tree != nullptr )
+      {
+        tree->Branch( name, address );
+        return;
+      }
+#ifdef NTUPLE_HAS_RNTUPLE
+      model->MakeField<typename RNTupleField<T>::type>( name );
+      bindings.push_back( std::make_pair( std::string(name), (void*)address ) );
+#endif
+    }
+    void Fill();
+    // Flush the RNTuple, before the file is written and closed
+    void Close();
+
+    TTree* tree;
+    Long64_t rows;
+
+  private:
+    std::string name;
+    TFile* file;
+    std::vector<std::pair<std::string, void*> > bindings;
+#ifdef NTUPLE_HAS_RNTUPLE
+    void openWriter();
+    std::unique_ptr<RNTupleAPI::RNTupleModel> model;
+    std::unique_ptr<RNTupleAPI::RNTupleWriter> writer;
+    std::unique_ptr<RNTupleAPI::REntry> entry;
+#endif
+};
+
+// Reader for ntuple outputs in either format. Columns are bound to
+// addresses as with SetBranchAddress and filled by GetEvent.
+class NtupleReader
+{
+  public:
+    NtupleReader( std::string fname, std::string name="output" );
+    ~NtupleReader();
+
+    template<class T> void SetBranchAddress( const char* column, T* address )
+    {
+      if( tree != nullptr )
+      {
+        tree->SetBranchAddress( column, treeAddress( address ) );
+        return;
+      }
+#ifdef NTUPLE_HAS_RNTUPLE
+      typedef typename RNTupleField<T>::type F;
+      auto view = std::make_shared<RNTupleAPI::RNTupleView<F> >( reader->GetView<F>( column ) );
+      loaders.push_back( [view, address]( Long64_t i ){ *address = (*view)( i ); } );
+#endif
+    }
+    Long64_t GetEntries();
+    void GetEvent( Long64_t i );
+
+    // The file stays open for the other objects in it (meta, header)
+    TFile* file;
+    TTree* tree;
+    bool isRNTuple;
+
+  private:
+    // Vectors and strings are TTree object branches, bound through a
+    // pointer held here
+    template<class T> T* treeAddress( T* address ) { return address; }
+    template<class T> std::vector<T>** treeAddress( std::vector<T>* address )
+    {
+      return pointers.hold( address );
+    }
+    std::string** treeAddress( std::string* address ) { return pointers.hold( address ); }
+
+    BranchPointers pointers;
+    std::vector<std::function<void(Long64_t)> > loaders;
+#ifdef NTUPLE_HAS_RNTUPLE
+    std::unique_ptr<RNTupleAPI::RNTupleReader> reader;
+#endif
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __PMTGeometry__
+#define __PMTGeometry__
+
+#include <RAT/DS/PMTInfo.hh>
+#include <vector>
+#include <map>
+
+// Structure-of-arrays copy of RAT::DS::PMTInfo indexed by PMT ID, built
+// once per run so hot loops read plain arrays instead of calling
+// GetType/GetPosition/GetDirection and building TVector3s per hit.
+// Directions are stored as unit vectors.
+class PMTGeometry
+{
+  public:
+    PMTGeometry( RAT::DS::PMTInfo* pmtinfo );
+
+    // 1 for every PMT of the given type, 0 otherwise
+    const std::vector<unsigned char>& mask( int type );
+    // IDs of every PMT of the given type, in ID order
+    const std::vector<int>& ids( int type );
+    int typeCount( int type ) { return ids(type).size(); }
+    // True when other describes exactly the same PMTs, so this copy can be
+    // kept for another file
+    bool matches( RAT::DS::PMTInfo* other ) const;
+
+    RAT::DS::PMTInfo* pmtinfo;
+    int count;
+    std::vector<int> type;
+    std::vector<double> x, y, z;
+    std::vector<double> u, v, w;
+
+  private:
+    std::map<int, std::vector<unsigned char> > masks;
+    std::map<int, std::vector<int> > idlists;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __StreamingStats__
+#define __StreamingStats__
+
+#include <vector>
+#include <map>
+#include <cstddef>
+
+// Merging t-digest (Dunning): quantile estimates from O(compression)
+// centroids, accurate in the tails. Values are buffered and folded into
+// the centroids when the buffer fills, so memory stays constant.
+class TDigest
+{
+  public:
+    TDigest( double compression=100 );
+    void add( double x, double w=1 );
+    void merge( const TDigest& other );
+    // q in [0, 1]; NaN when empty
+    double quantile( double q );
+    double weight() const { return total + buffered; }
+
+  private:
+    class Centroid
+    {
+      public:
+        double mean;
+        double weight;
+    };
+    void compress();
+
+    double compression;
+    std::vector<Centroid> centroids;   // sorted by mean
+    std::vector<Centroid> buffer;
+    double total;                      // weight in centroids
+    double buffered;                   // weight in buffer
+    double min, max;
+};
+
+// Count, mean and variance by Welford's update, plus quantiles. Two
+// accumulators merge exactly in count and to rounding in mean and
+// variance (Chan et al.), so per-thread or per-file results can be
+// combined. While every value is an integer and there are at most
+// maxDistinct different ones, as for hit counts, the values are also
+// counted exactly and quantiles are values of the data. Otherwise they
+// are t-digest estimates, interpolated between centroids.
+class StreamingStats
+{
+  public:
+    static const size_t maxDistinct = 4096;
+
+    StreamingStats( double compression=100 );
+    void add( double x );
+    void merge( const StreamingStats& other );
+    void clear();
+    // NaN without values, as the sums over an empty pedestal list gave
+    double mean() const;
+    // Population variance, as the pedestal spread has always been defined
+    double variance() const;
+    double stddev() const;
+    // When exact, the smallest value with at least q n values at or below
+    // it; NaN without values
+    double quantile( double q );
+    bool exact() const { return counting; }
+
+    long long n;
+  private:
+    double compression;
+    double m;
+    double m2;
+    TDigest digest;
+    bool counting;
+    std::map<long long, long long> histogram;
+};
+
+#endif
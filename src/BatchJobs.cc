@@ -0,0 +1,97 @@
+#include <BatchJobs.hh>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <glob.h>
+
+BatchJobs::BatchJobs( std::vector<std::string> inputs, std::string manifest, std::string outdir ) :
+  outdir(outdir)
+{
+  // Legacy form: exactly one input and its output
+  if( manifest.empty() && outdir.empty() )
+  {
+    if( inputs.size() != 2 )
+    {
+      std::cerr << "Give an input and an output, or inputs with --outdir / --manifest" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    add( inputs[0], inputs[1] );
+    return;
+  }
+  if( !manifest.empty() )
+  {
+    std::ifstream list( manifest.c_str() );
+    if( !list )
+    {
+      std::cerr << "Cannot read manifest " << manifest << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    std::string line;
+    while( std::getline( list, line ) )
+    {
+      line = line.substr( 0, line.find('#') );
+      std::istringstream words( line );
+      std::string input, output;
+      if( !(words >> input) ) continue;
+      words >> output;
+      if( output.empty() )
+        expand( input );
+      else
+        add( input, output );
+    }
+  }
+  for( auto& in : inputs )
+    expand( in );
+  if( jobs.size() == 0 )
+  {
+    std::cerr << "No input files" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void BatchJobs::expand( std::string pattern )
+{
+  if( outdir.empty() )
+  {
+    std::cerr << "No output for " << pattern << ", set --outdir" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::vector<std::string> matches;
+  if( pattern.find_first_of("*?[") == std::string::npos )
+    matches.push_back( pattern );
+  else
+  {
+    // Quoted patterns keep long campaigns clear of the shell's argument limit
+    glob_t found;
+    if( glob( pattern.c_str(), 0, NULL, &found ) == 0 )
+      for( size_t i=0; i < found.gl_pathc; i++ )
+        matches.push_back( found.gl_pathv[i] );
+    globfree( &found );
+    if( matches.size() == 0 )
+      std::cerr << "Warning: " << pattern << " matches nothing" << std::endl;
+  }
+  for( auto& in : matches )
+  {
+    std::string base = in.substr( in.find_last_of('/') + 1 );
+    add( in, outdir + "/" + base );
+  }
+}
+
+void BatchJobs::add( std::string input, std::string output )
+{
+  if( input == output )
+  {
+    std::cerr << "Output would overwrite its input " << input << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // A file listed twice (manifest and glob) is only processed once
+  for( auto& job : jobs )
+  {
+    if( job.second != output ) continue;
+    if( job.first == input ) return;
+    std::cerr << "Both " << job.first << " and " << input << " write " << output << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  jobs.push_back( std::make_pair( input, output ) );
+}
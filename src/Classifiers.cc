@@ -0,0 +1,144 @@
+#include <Classifiers.hh>
+#include <cmath>
+
+ChargeBalance::ChargeBalance( PMTGeometry* geometry, int usetype ) :
+  geometry(geometry), usetype(usetype)
+{
+  this->pmtcount = geometry->typeCount(usetype);
+}
+
+double ChargeBalance::GetCB( RAT::DS::EV* ev )
+{
+  const std::vector<unsigned char>& selected = geometry->mask(usetype);
+  int pmthits       = ev->GetPMTCount();
+  double qsumsquare = 0;
+  double qsum       = 0;
+  for(int pmtc=0; pmtc < pmthits; pmtc++)
+  {
+    RAT::DS::PMT* pmt = ev->GetPMT(pmtc);
+    if( !selected[pmt->GetID()] ) continue;
+    double charge = pmt->GetCharge();
+    qsumsquare += charge * charge;
+    qsum += charge;
+  }
+  return sqrt( qsumsquare/pow(qsum, 2) - 1 / pmthits );
+}
+
+double ChargeBalance::GetCB( const HitArrays& hits )
+{
+  int pmthits = hits.size();
+  ChargeStats stats = HitKernels::chargeStats( hits, usetype );
+  return sqrt( stats.sumsq/pow(stats.sum, 2) - 1 / pmthits );
+}
+
+double ChargeBalance::GetCB( HitSummary& summary )
+{
+  int pmthits = summary.staged.size();
+  ChargeStats stats = summary.typeStats( usetype );
+  return sqrt( stats.sumsq/pow(stats.sum, 2) - 1 / pmthits );
+}
+
+Isotropy::Isotropy( PMTGeometry* geometry, int usetype ) :
+  validate(false), validated(0), maxDeviation(0), geometry(geometry), usetype(usetype)
+{
+  this->pmtcount = geometry->typeCount(usetype);
+}
+
+double Isotropy::GetIsotropy( RAT::DS::EV* ev, TVector3 position )
+{
+  int pmthits = ev->GetPMTCount();
+  double px   = position.X();
+  double py   = position.Y();
+  double pz   = position.Z();
+  hx.resize( pmthits );
+  hy.resize( pmthits );
+  hz.resize( pmthits );
+  for( int pmtc=0; pmtc < pmthits; pmtc++ )
+  {
+    int id    = ev->GetPMT(pmtc)->GetID();
+    double dx = geometry->x[id] - px;
+    double dy = geometry->y[id] - py;
+    double dz = geometry->z[id] - pz;
+    double r  = sqrt( dx*dx + dy*dy + dz*dz );
+    double scale = r > 0 ? 1.0 / r : 0.0;
+    hx[pmtc] = dx * scale;
+    hy[pmtc] = dy * scale;
+    hz[pmtc] = dz * scale;
+  }
+  double isotropy = harmonicIsotropy();
+  if( validate )
+  {
+    double deviation = fabs( isotropy - pairwiseIsotropy() );
+    if( deviation > maxDeviation || isnan(deviation) ) maxDeviation = deviation;
+    validated++;
+  }
+  return isotropy;
+}
+
+double Isotropy::pairwiseIsotropy()
+{
+  // Reference O(N^2) sum over hit pairs
+  int pmthits = hx.size();
+  double p1   = 0.0;
+  double p4   = 0.0;
+  for( int pmt1=0; pmt1 < pmthits; pmt1++ )
+  {
+    for( int pmt2=pmt1 + 1; pmt2 < pmthits; pmt2++ )
+    {
+      double thetaij = hx[pmt1]*hx[pmt2] + hy[pmt1]*hy[pmt2] + hz[pmt1]*hz[pmt2];
+      p1 += thetaij;
+      double tij2 = thetaij * thetaij;
+      p4 += ( 35*tij2*tij2 - 30*tij2 + 3 ) / 8;
+    }
+  }
+  p1 = 2 * p1 / static_cast<double>( pmthits * ( pmthits - 1 ) );
+  p4 = 2 * p4 / static_cast<double>( pmthits * ( pmthits - 1 ) );
+  return p1 + 4*p4;
+}
+
+double Isotropy::harmonicIsotropy()
+{
+  // Addition theorem, with P_l^m(z) e^{im phi} = D_l^m(z) (x+iy)^m where
+  // D_l^m is the m-th derivative of P_l:
+  //   sum_ij P_l(n_i.n_j) = sum_m c_m |sum_i D_l^m(z_i) (x_i+iy_i)^m|^2
+  // with c_0 = 1, c_m = 2 (l-m)!/(l+m)!. The pairs i<j are then (S - N)/2.
+  int pmthits = hx.size();
+  double a1x = 0, a1y = 0, a1z = 0;
+  double re[5] = {0, 0, 0, 0, 0};
+  double im[5] = {0, 0, 0, 0, 0};
+  for( int i=0; i < pmthits; i++ )
+  {
+    double x = hx[i], y = hy[i], z = hz[i];
+    a1x += x;
+    a1y += y;
+    a1z += z;
+    double z2 = z*z;
+    double d[5] = { (35*z2*z2 - 30*z2 + 3) / 8, (35*z2*z - 15*z) / 2,
+                    (105*z2 - 15) / 2, 105*z, 105 };
+    // Powers of x+iy
+    double pr = 1, pi = 0;
+    for( int m=0; m <= 4; m++ )
+    {
+      re[m] += d[m] * pr;
+      im[m] += d[m] * pi;
+      double nr = pr*x - pi*y;
+      pi = pr*y + pi*x;
+      pr = nr;
+    }
+  }
+  const double c4[5] = { 1.0, 1.0/10, 1.0/180, 1.0/2520, 1.0/20160 };
+  double s1 = a1x*a1x + a1y*a1y + a1z*a1z;
+  double s4 = 0;
+  for( int m=0; m <= 4; m++ )
+    s4 += c4[m] * ( re[m]*re[m] + im[m]*im[m] );
+  double pairs = static_cast<double>( pmthits * ( pmthits - 1 ) );
+  double p1 = ( s1 - pmthits ) / pairs;
+  double p4 = ( s4 - pmthits ) / pairs;
+  return p1 + 4*p4;
+}
+
+void Isotropy::printValidation()
+{
+  printf("Isotropy validation: %ld calls, max |harmonic - pairwise| = %g\n",
+      validated, maxDeviation);
+}
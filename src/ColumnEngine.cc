@@ -0,0 +1,701 @@
+#include <ColumnEngine.hh>
+#include <ClusterQueue.hh>
+#include <RAT/DS/MC.hh>
+#include <RAT/DS/MCParticle.hh>
+#include <RAT/DS/PathFit.hh>
+#include <RAT/DS/Centroid.hh>
+#include <TTimeStamp.h>
+#include <boost/property_tree/json_parser.hpp>
+#include <iostream>
+#include <sstream>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <mutex>
+
+namespace pt = boost::property_tree;
+
+namespace
+{
+  // Standard columns, the extractor and parameters used when a config
+  // entry gives only a name. Together they are the mkntuple schema.
+  const char* standardColumns = R"({
+    "name":         { "extractor": "name" },
+    "nanotime":     { "extractor": "nanotime" },
+    "mcx":          { "extractor": "mc", "field": "x" },
+    "mcy":          { "extractor": "mc", "field": "y" },
+    "mcz":          { "extractor": "mc", "field": "z" },
+    "mcu":          { "extractor": "mc", "field": "u" },
+    "mcv":          { "extractor": "mc", "field": "v" },
+    "mcw":          { "extractor": "mc", "field": "w" },
+    "mcke":         { "extractor": "mc", "field": "ke" },
+    "mcpcount":     { "extractor": "mccount" },
+    "evid":         { "extractor": "evid" },
+    "subev":        { "extractor": "subev" },
+    "pedestal":     { "extractor": "window", "min": -150, "max": -50 },
+    "n100":         { "extractor": "window", "min": -20, "max": 80 },
+    "n400":         { "extractor": "window", "min": -50, "max": 350 },
+    "veto":         { "extractor": "window", "min": -50, "max": 350, "type": 2 },
+    "Q":            { "extractor": "charge", "type": 1 },
+    "vQ":           { "extractor": "charge", "type": 2 },
+    "maxQ":         { "extractor": "charge", "type": 1, "max": true },
+    "x":            { "extractor": "pathfit", "field": "x" },
+    "y":            { "extractor": "pathfit", "field": "y" },
+    "z":            { "extractor": "pathfit", "field": "z" },
+    "u":            { "extractor": "pathfit", "field": "u" },
+    "v":            { "extractor": "pathfit", "field": "v" },
+    "w":            { "extractor": "pathfit", "field": "w" },
+    "chi2":         { "extractor": "pathfit", "field": "goodness" },
+    "qx":           { "extractor": "centroid", "field": "x" },
+    "qy":           { "extractor": "centroid", "field": "y" },
+    "qz":           { "extractor": "centroid", "field": "z" },
+    "qbal":         { "extractor": "chargebalance" },
+    "isotropyPath": { "extractor": "isotropy", "vertex": "pathfit" },
+    "isotropyQfit": { "extractor": "isotropy", "vertex": "centroid" },
+    "pdg":          { "extractor": "pdg" },
+    "mcEnergy":     { "extractor": "mcvector", "field": "ke" },
+    "mcposx":       { "extractor": "mcvector", "field": "posx" },
+    "mcposy":       { "extractor": "mcvector", "field": "posy" },
+    "mcposz":       { "extractor": "mcvector", "field": "posz" },
+    "mcdirx":       { "extractor": "mcvector", "field": "dirx" },
+    "mcdiry":       { "extractor": "mcvector", "field": "diry" },
+    "mcdirz":       { "extractor": "mcvector", "field": "dirz" }
+  })";
+
+  pt::ptree standardSpecs()
+  {
+    pt::ptree standard;
+    std::istringstream text( standardColumns );
+    pt::read_json( text, standard );
+    return standard;
+  }
+
+  int axisIndex( std::string field )
+  {
+    if( field == "x" || field == "u" ) return 0;
+    if( field == "y" || field == "v" ) return 1;
+    if( field == "z" || field == "w" ) return 2;
+    std::cerr << "Unknown axis " << field << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Scalar column stored as double, or as int with "as": "int"
+  Column* numeric( std::string name, const pt::ptree& spec, std::function<double(ColumnEngine&)> get )
+  {
+    if( spec.get<std::string>( "as", "double" ) == "int" )
+      return new ValueColumn<int>( name, [get](ColumnEngine& e, int& v){ v = get(e); } );
+    return new ValueColumn<double>( name, [get](ColumnEngine& e, double& v){ v = get(e); } );
+  }
+
+  void registerExtractors( std::map<std::string, ColumnFactory>& r )
+  {
+    r["name"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      return new ValueColumn<std::string>( name, [](ColumnEngine& e, std::string& v){ v = *e.dsname; } );
+    };
+    r["nanotime"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::MC;
+      return new ValueColumn<ULong64_t>( name, [](ColumnEngine& e, ULong64_t& v){
+          v = static_cast<ULong64_t>(e.ev->GetCalibratedTriggerTime()) + e.mctime(); } );
+    };
+    r["evid"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      return new ValueColumn<int>( name, [](ColumnEngine& e, int& v){ v = e.ev->GetID(); } );
+    };
+    r["subev"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      return new ValueColumn<int>( name, [](ColumnEngine& e, int& v){ v = e.subev; } );
+    };
+    // First particle position / direction, or summed kinetic energy
+    r["mc"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::MC | DSBranchSelector::MCParticles;
+      std::string field = spec.get<std::string>( "field" );
+      if( field == "ke" )
+        return numeric( name, spec, [](ColumnEngine& e){
+            const std::vector<double>& ke = e.mc("ke");
+            return std::accumulate( ke.begin(), ke.end(), 0.0 ); } );
+      std::string vec = ( field == "x" || field == "y" || field == "z" ) ? "pos" : "dir";
+      vec += "xyz"[ axisIndex(field) ];
+      return numeric( name, spec, [vec](ColumnEngine& e){
+          const std::vector<double>& values = e.mc(vec);
+          return values.size() > 0 ? values[0] : 0.0; } );
+    };
+    r["mccount"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::MC | DSBranchSelector::MCParticles;
+      return new ValueColumn<int>( name, [](ColumnEngine& e, int& v){ v = e.pdg().size(); } );
+    };
+    r["mcvector"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::MC | DSBranchSelector::MCParticles;
+      std::string field = spec.get<std::string>( "field" );
+      return new ValueColumn<std::vector<double> >( name,
+          [field](ColumnEngine& e, std::vector<double>& v){ v = e.mc(field); } );
+    };
+    r["pdg"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::MC | DSBranchSelector::MCParticles;
+      return new ValueColumn<std::vector<Int_t> >( name,
+          [](ColumnEngine& e, std::vector<Int_t>& v){ v = e.pdg(); } );
+    };
+    r["pathfit"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::PathFit;
+      std::string field = spec.get<std::string>( "field" );
+      if( field == "goodness" )
+        return numeric( name, spec, [](ColumnEngine& e){ return e.ev->GetPathFit()->GetGoodness(); } );
+      int axis = axisIndex( field );
+      if( field == "u" || field == "v" || field == "w" )
+        return numeric( name, spec, [axis](ColumnEngine& e){ return e.pathDirection()[axis]; } );
+      return numeric( name, spec, [axis](ColumnEngine& e){ return e.pathPosition()[axis]; } );
+    };
+    r["centroid"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::Centroid;
+      int axis = axisIndex( spec.get<std::string>( "field" ) );
+      return numeric( name, spec, [axis](ColumnEngine& e){ return e.centroid()[axis]; } );
+    };
+    // Q_Reco_X/Y/Z vector branches next to ds, 0 when the file has none
+    r["qreco"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      int axis = axisIndex( spec.get<std::string>( "field" ) );
+      engine.needQReco = true;
+      return numeric( name, spec, [axis](ColumnEngine& e){ return e.qreco(axis); } );
+    };
+    r["window"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::PMTs;
+      int index = engine.addWindow( name, spec.get<double>("min"), spec.get<double>("max"),
+          spec.get<int>( "type", 1 ) );
+      return new ValueColumn<int>( name, [index](ColumnEngine& e, int& v){ v = e.hits()->counts[index]; } );
+    };
+    r["charge"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::PMTs;
+      int type = spec.get<int>( "type", 1 );
+      engine.needGeometry = true;
+      if( spec.get<bool>( "max", false ) )
+        return numeric( name, spec, [type](ColumnEngine& e){ return e.hits()->maxCharge(type); } );
+      return numeric( name, spec, [type](ColumnEngine& e){ return e.hits()->charge(type); } );
+    };
+    r["chargebalance"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      engine.parts |= DSBranchSelector::PMTs;
+      int type = spec.get<int>( "type", 1 );
+      engine.needGeometry = true;
+      return numeric( name, spec, [type](ColumnEngine& e){
+          return e.chargeBalance(type)->GetCB( *e.hits() ); } );
+    };
+    r["isotropy"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      int type = spec.get<int>( "type", 1 );
+      engine.needGeometry = true;
+      bool centroid = spec.get<std::string>( "vertex", "pathfit" ) == "centroid";
+      engine.parts |= DSBranchSelector::PMTs | ( centroid ? DSBranchSelector::Centroid : DSBranchSelector::PathFit );
+      if( centroid )
+        return numeric( name, spec, [type](ColumnEngine& e){
+            return e.isotropy(type)->GetIsotropy( e.ev, e.centroid() ); } );
+      return numeric( name, spec, [type](ColumnEngine& e){
+          return e.isotropy(type)->GetIsotropy( e.ev, e.pathPosition() ); } );
+    };
+    // EV level quantities filled by the detector simulation
+    r["totalcharge"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      return numeric( name, spec, [](ColumnEngine& e){ return e.ev->GetTotalCharge(); } );
+    };
+    r["deltat"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      return numeric( name, spec, [](ColumnEngine& e){ return e.ev->GetDeltaT(); } );
+    };
+    r["constant"] = []( std::string name, const pt::ptree& spec, ColumnEngine& engine ) -> Column* {
+      double value = spec.get<double>( "value", 0 );
+      return numeric( name, spec, [value](ColumnEngine& e){ return value; } );
+    };
+  }
+
+  // Worker: its own file handle and engine, so nothing but the queue is
+  // shared. Clusters are taken in order and their rows handed back to
+  // the writer as bytes.
+  void clusterWorker( std::string iname, ColumnEngine* parent, ClusterQueue<ColumnRows>* queue )
+  {
+    TFile* tfile = new TFile(iname.c_str());
+    TTree* T     = (TTree*)tfile->Get("T");
+    ColumnEngine* engine = new ColumnEngine( parent->config );
+    engine->validate = parent->validate;
+    engine->open( tfile, T, false );
+    size_t k;
+    while( queue->take( k ) )
+    {
+      ColumnRows rows;
+      for( Long64_t i=queue->ranges[k].first; i < queue->ranges[k].second; i++ )
+        engine->fill( i, rows );
+      queue->finish( k, rows );
+    }
+    {
+      std::lock_guard<std::mutex> guard( queue->lock );
+      parent->mergeValidation( *engine );
+    }
+    T->ResetBranchAddresses();
+    delete engine;
+    delete tfile;
+  }
+}
+
+std::map<std::string, ColumnFactory>& ColumnEngine::registry()
+{
+  static std::map<std::string, ColumnFactory> r;
+  if( r.size() == 0 )
+    registerExtractors( r );
+  return r;
+}
+
+ColumnEngine::ColumnEngine( const pt::ptree& config ) :
+  validate(false), ds(nullptr), dsname(nullptr), ev(nullptr), subev(0),
+  needGeometry(false), needQReco(false), parts(DSBranchSelector::EV),
+  pedestalColumn(nullptr), config(config), T(nullptr), readDS(nullptr), readName(nullptr),
+  run(nullptr), geometry(nullptr), summary(nullptr),
+  mcReady(false), mcT(0), pathReady(false), centroidReady(false), hitsReady(false),
+  qrecoX(nullptr), qrecoY(nullptr), qrecoZ(nullptr)
+{
+  pt::ptree standard = standardSpecs();
+  for( const auto& entry : config.get_child( "columns" ) )
+  {
+    pt::ptree spec = entry.second;
+    // A bare string is the name of a standard column
+    if( spec.empty() )
+    {
+      std::string plain = spec.get_value<std::string>();
+      spec = pt::ptree();
+      spec.put( "name", plain );
+    }
+    std::string name = spec.get<std::string>( "name" );
+    if( !spec.count( "extractor" ) )
+    {
+      if( !standard.count( name ) )
+      {
+        std::cerr << "Column " << name << " needs an extractor" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      for( const auto& p : standard.get_child( name ) )
+        if( !spec.count( p.first ) )
+          spec.add_child( p.first, p.second );
+    }
+    std::string extractor = spec.get<std::string>( "extractor" );
+    auto factory = registry().find( extractor );
+    if( factory == registry().end() )
+    {
+      std::cerr << "Unknown extractor " << extractor << " for column " << name << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    columns.push_back( factory->second( name, spec, *this ) );
+  }
+
+  std::string pedestal = config.get<std::string>( "pedestal", "pedestal" );
+  for( auto c : columns )
+    if( c->name == pedestal ) pedestalColumn = c;
+}
+
+ColumnEngine::~ColumnEngine()
+{
+  for( auto c : columns ) delete c;
+  for( auto p : balances ) delete p.second;
+  for( auto p : isotropies ) delete p.second;
+  delete summary;
+  delete geometry;
+  delete run;
+  delete readDS;
+  delete readName;
+}
+
+ColumnEngine* ColumnEngine::fromFile( std::string fname )
+{
+  pt::ptree config;
+  pt::read_json( fname, config );
+  return new ColumnEngine( config );
+}
+
+ColumnEngine* ColumnEngine::fromString( std::string json )
+{
+  pt::ptree config;
+  std::istringstream text( json );
+  pt::read_json( text, config );
+  return new ColumnEngine( config );
+}
+
+ColumnEngine* ColumnEngine::standard()
+{
+  pt::ptree columns;
+  for( const auto& spec : standardSpecs() )
+  {
+    pt::ptree name;
+    name.put_value( spec.first );
+    columns.push_back( std::make_pair( "", name ) );
+  }
+  pt::ptree config;
+  config.add_child( "columns", columns );
+  return new ColumnEngine( config );
+}
+
+int ColumnEngine::addWindow( std::string name, double minT, double maxT, int type )
+{
+  needGeometry = true;
+  windows.push_back( HitWindow( name, minT, maxT, type ) );
+  return windows.size() - 1;
+}
+
+void ColumnEngine::processFile( std::string iname, std::string oname, bool rntuple, int nthreads )
+{
+  TFile* tfile = new TFile(iname.c_str());
+  TTree* T     = (TTree*)tfile->Get("T");
+  open( tfile, T );
+  Long64_t entries = T->GetEntries();
+
+  TFile* otfile = new TFile(oname.c_str(), "recreate");
+  NtupleOutput* output;
+  if( rntuple )
+    output = new NtupleOutput("output", otfile);
+  else
+    output = new NtupleOutput(new TTree("output", "output"));
+  TTree* meta   = new TTree("meta", "meta");
+  NewBranches( output );
+
+  printf("Begin loop\n");
+  auto start = std::chrono::steady_clock::now();
+  if( nthreads > 1 )
+    fillThreaded( iname, T, output, nthreads );
+  else
+  {
+    for( Long64_t i=0; i < entries; i++ )
+      fill( i, output );
+  }
+  // Rows are committed before the file is written
+  output->Close();
+  printValidation();
+
+  // If header, store livetime, else make one up
+  double livetime = -1.0;
+  if( tfile->GetListOfKeys()->Contains("header") )
+  {
+    TTree* header = (TTree*)tfile->Get("header");
+    // Merged backgrounds carry a livetime, signals an efficiency
+    if( header->GetListOfLeaves()->Contains("livetime") )
+      header->SetBranchAddress("livetime", &livetime);
+    else if( header->GetListOfLeaves()->Contains("efficiency") )
+      header->SetBranchAddress("efficiency", &livetime);
+    header->GetEvent(0);
+    header->ResetBranchAddresses();
+  }
+  fillMeta( meta, livetime );
+
+  otfile->Write(0, TObject::kOverwrite);
+  // Same numbers for either output format, to compare them
+  printf("Wrote %lld rows as %s in %.1f s, file size %lld bytes\n", output->rows,
+      rntuple ? "RNTuple" : "TTree",
+      std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count(),
+      otfile->GetSize());
+  delete output;
+  // Close both files, batches can run through thousands of them
+  delete otfile;
+  T->ResetBranchAddresses();
+  delete tfile;
+}
+
+// Split T at its cluster boundaries over nthreads worker engines. Rows
+// are loaded back into this engine's columns cluster by cluster in entry
+// order, so the output and the pedestal statistics match the serial loop.
+void ColumnEngine::fillThreaded( std::string iname, TTree* T, NtupleOutput* output, int nthreads )
+{
+  ClusterQueue<ColumnRows> queue( T, nthreads );
+  printf("Splitting %lld entries in %zu clusters over %d threads\n",
+      T->GetEntries(), queue.ranges.size(), nthreads);
+
+  std::vector<std::thread> workers;
+  for( int i=0; i < nthreads; i++ )
+    workers.push_back( std::thread( clusterWorker, iname, this, &queue ) );
+  for( size_t k=0; k < queue.ranges.size(); k++ )
+    fillRows( queue.collect( k ), output );
+  for( auto& t : workers ) t.join();
+}
+
+void ColumnEngine::open( TFile* tfile, TTree* T, bool report )
+{
+  this->T = T;
+  if( readDS == nullptr ) readDS = new RAT::DS::Root();
+  if( readName == nullptr ) readName = new std::string();
+  *readName = "signal";
+  // Only the parts of ds the requested columns use are read
+  DSBranchSelector selector( T, parts );
+  if( report )
+    selector.report();
+  T->SetBranchAddress( "ds", &readDS, 0 );
+  if( T->GetListOfLeaves()->Contains("name") )
+    T->SetBranchAddress( "name", &readName );
+
+  qrecoX = qrecoY = qrecoZ = nullptr;
+  if( needQReco && T->GetListOfLeaves()->Contains("Q_Reco_X") )
+  {
+    T->SetBranchAddress( "Q_Reco_X", &qrecoX );
+    T->SetBranchAddress( "Q_Reco_Y", &qrecoY );
+    T->SetBranchAddress( "Q_Reco_Z", &qrecoZ );
+  }
+
+  // The PMTInfo is only decoded when a column uses the hits
+  if( needGeometry )
+  {
+    TTree* runT = (TTree*)tfile->Get("runT");
+    if( run == nullptr ) run = new RAT::DS::Run();
+    runT->SetBranchAddress( "run", &run );
+    runT->GetEvent(0);
+    open( run->GetPMTInfo() );
+    runT->ResetBranchAddresses();
+  }
+}
+
+void ColumnEngine::open( RAT::DS::PMTInfo* pmtinfo )
+{
+  if( !needGeometry ) return;
+  if( geometry == nullptr || !geometry->matches( pmtinfo ) )
+    buildGeometry( pmtinfo );
+  geometry->pmtinfo = pmtinfo;
+}
+
+void ColumnEngine::buildGeometry( RAT::DS::PMTInfo* pmtinfo )
+{
+  for( auto p : balances ) delete p.second;
+  for( auto p : isotropies ) delete p.second;
+  balances.clear();
+  isotropies.clear();
+  delete summary;
+  delete geometry;
+  geometry = new PMTGeometry( pmtinfo );
+  summary = new HitSummary( geometry );
+  for( auto& w : windows )
+    summary->addWindow( w.name, w.minT, w.maxT, w.type );
+}
+
+void ColumnEngine::NewBranches( NtupleOutput* output )
+{
+  for( auto c : columns )
+    c->branch( output );
+}
+
+void ColumnEngine::fill( Long64_t entry, NtupleOutput* output )
+{
+  T->GetEvent( entry );
+  fill( readDS, *readName, output );
+}
+
+void ColumnEngine::fill( RAT::DS::Root* event, const std::string& name, NtupleOutput* output )
+{
+  ds = event;
+  dsname = &name;
+  newEvent();
+  for( int sub=0; sub < ds->GetEVCount(); sub++ )
+  {
+    evaluate( sub );
+    fillRow( output );
+  }
+}
+
+void ColumnEngine::fill( Long64_t entry, ColumnRows& rows )
+{
+  T->GetEvent( entry );
+  ds = readDS;
+  dsname = readName;
+  newEvent();
+  for( int sub=0; sub < ds->GetEVCount(); sub++ )
+  {
+    evaluate( sub );
+    for( auto c : columns )
+      c->store( rows.bytes );
+    rows.count++;
+  }
+}
+
+void ColumnEngine::fillRows( const ColumnRows& rows, NtupleOutput* output )
+{
+  const char* p = rows.bytes.data();
+  for( size_t r=0; r < rows.count; r++ )
+  {
+    for( auto c : columns )
+      c->load( p );
+    fillRow( output );
+  }
+}
+
+void ColumnEngine::evaluate( int sub )
+{
+  newEV( sub );
+  for( auto c : columns )
+    c->fill( *this );
+}
+
+void ColumnEngine::fillRow( NtupleOutput* output )
+{
+  if( pedestalColumn != nullptr )
+    pedestals.add( pedestalColumn->number() );
+  output->Fill();
+}
+
+void ColumnEngine::fillMeta( TTree* meta, double livetime )
+{
+  double avg_pedestal = 0, std_pedestal = 0;
+  double p05 = 0, p50 = 0, p95 = 0, p99 = 0;
+  if( pedestalColumn != nullptr )
+  {
+    avg_pedestal = pedestals.mean();
+    std_pedestal = pedestals.stddev();
+    // Exact for integer columns such as hit windows, t-digest estimates
+    // for a pedestal column with fractional values
+    p05 = pedestals.quantile(0.05);
+    p50 = pedestals.quantile(0.50);
+    p95 = pedestals.quantile(0.95);
+    p99 = pedestals.quantile(0.99);
+    printf("Avg %f, std %f, median %f, 99%% %f \n", avg_pedestal, std_pedestal, p50, p99);
+    meta->Branch("AvgPedestal", &avg_pedestal);
+    meta->Branch("StdPedestal", &std_pedestal);
+    meta->Branch("PedestalP05", &p05);
+    meta->Branch("PedestalP50", &p50);
+    meta->Branch("PedestalP95", &p95);
+    meta->Branch("PedestalP99", &p99);
+  }
+  meta->Branch("livetime", &livetime);
+  meta->Fill();
+  meta->ResetBranchAddresses();
+  pedestals.clear();
+}
+
+void ColumnEngine::printValidation()
+{
+  if( !validate ) return;
+  for( auto p : isotropies )
+  {
+    p.second->printValidation();
+    p.second->validated = 0;
+    p.second->maxDeviation = 0;
+  }
+}
+
+void ColumnEngine::mergeValidation( ColumnEngine& other )
+{
+  for( auto p : other.isotropies )
+  {
+    Isotropy* iso = isotropy( p.first );
+    iso->validated += p.second->validated;
+    if( p.second->maxDeviation > iso->maxDeviation || std::isnan(p.second->maxDeviation) )
+      iso->maxDeviation = p.second->maxDeviation;
+  }
+}
+
+void ColumnEngine::newEvent()
+{
+  mcReady = false;
+}
+
+void ColumnEngine::newEV( int sub )
+{
+  subev = sub;
+  ev = ds->GetEV( sub );
+  pathReady = false;
+  centroidReady = false;
+  hitsReady = false;
+}
+
+ULong64_t ColumnEngine::mctime()
+{
+  mc( "ke" );
+  return mcT;
+}
+
+const std::vector<double>& ColumnEngine::mc( const std::string& field )
+{
+  if( !mcReady )
+  {
+    ULong64_t stonano = 1000000000;
+    RAT::DS::MC* mc = ds->GetMC();
+    TTimeStamp mcTTS = mc->GetUTC();
+    mcT = static_cast<ULong64_t>(mcTTS.GetSec())*stonano +
+          static_cast<ULong64_t>(mcTTS.GetNanoSec());
+    const char* names[] = { "ke", "posx", "posy", "posz", "dirx", "diry", "dirz" };
+    for( auto n : names ) mcFields[n].clear();
+    pdgcodes.clear();
+    for( int p=0; p < mc->GetMCParticleCount(); p++ )
+    {
+      RAT::DS::MCParticle* particle = mc->GetMCParticle(p);
+      pdgcodes.push_back( particle->GetPDGCode() );
+      mcFields["ke"].push_back( particle->GetKE() );
+      TVector3 mcpos = particle->GetPosition();
+      TVector3 mcdir = particle->GetMomentum();
+      mcFields["posx"].push_back( mcpos.X() );
+      mcFields["posy"].push_back( mcpos.Y() );
+      mcFields["posz"].push_back( mcpos.Z() );
+      mcFields["dirx"].push_back( mcdir.X()/mcdir.Mag() );
+      mcFields["diry"].push_back( mcdir.Y()/mcdir.Mag() );
+      mcFields["dirz"].push_back( mcdir.Z()/mcdir.Mag() );
+    }
+    mcReady = true;
+  }
+  auto found = mcFields.find( field );
+  if( found == mcFields.end() )
+  {
+    std::cerr << "Unknown MC field " << field << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return found->second;
+}
+
+const std::vector<Int_t>& ColumnEngine::pdg()
+{
+  mc( "ke" );
+  return pdgcodes;
+}
+
+const TVector3& ColumnEngine::pathPosition()
+{
+  if( !pathReady )
+  {
+    RAT::DS::PathFit* fit = ev->GetPathFit();
+    pathPos = fit->GetPosition();
+    pathDir = fit->GetDirection();
+    pathReady = true;
+  }
+  return pathPos;
+}
+
+const TVector3& ColumnEngine::pathDirection()
+{
+  pathPosition();
+  return pathDir;
+}
+
+const TVector3& ColumnEngine::centroid()
+{
+  if( !centroidReady )
+  {
+    centroidPos = ev->GetCentroid()->GetPosition();
+    centroidReady = true;
+  }
+  return centroidPos;
+}
+
+double ColumnEngine::qreco( int axis )
+{
+  std::vector<double>* values = axis == 0 ? qrecoX : ( axis == 1 ? qrecoY : qrecoZ );
+  if( values == nullptr ) return 0;
+  return values->at( subev );
+}
+
+HitSummary* ColumnEngine::hits()
+{
+  if( !hitsReady )
+  {
+    summary->process( ev );
+    hitsReady = true;
+  }
+  return summary;
+}
+
+ChargeBalance* ColumnEngine::chargeBalance( int type )
+{
+  ChargeBalance*& cb = balances[type];
+  if( cb == nullptr ) cb = new ChargeBalance( geometry, type );
+  return cb;
+}
+
+Isotropy* ColumnEngine::isotropy( int type )
+{
+  Isotropy*& iso = isotropies[type];
+  if( iso == nullptr )
+  {
+    iso = new Isotropy( geometry, type );
+    iso->validate = validate;
+  }
+  return iso;
+}
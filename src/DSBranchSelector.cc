@@ -0,0 +1,72 @@
+#include <DSBranchSelector.hh>
+#include <TObjArray.h>
+#include <TBranch.h>
+#include <iostream>
+#include <cstdio>
+
+DSBranchSelector::DSBranchSelector( TTree* T, int parts, std::string dsbranch ) :
+  T(T), parts(parts), dsbranch(dsbranch), bytesRead(0), bytesSkipped(0)
+{
+  if( parts == Everything ) return;
+  // Sub-branches of a split top level branch are named without its prefix,
+  // so switch everything off and the other top level branches back on
+  T->SetBranchStatus( "*", 0 );
+  TObjArray* branches = T->GetListOfBranches();
+  for( int i=0; i < branches->GetEntriesFast(); i++ )
+  {
+    std::string name = branches->At(i)->GetName();
+    if( name != dsbranch )
+      T->SetBranchStatus( name.c_str(), 1 );
+  }
+  // Whole collections first, then drop their heavy members not asked for
+  if( parts & (EV | PMTs | PathFit | Centroid) )
+  {
+    T->SetBranchStatus( "ev*", 1 );
+    if( !(parts & PMTs) )     T->SetBranchStatus( "ev.pmt*", 0 );
+    if( !(parts & PathFit) )  T->SetBranchStatus( "ev.pathfit*", 0 );
+    if( !(parts & Centroid) ) T->SetBranchStatus( "ev.centroid*", 0 );
+  }
+  if( parts & (MC | MCParticles | MCPMTs) )
+  {
+    T->SetBranchStatus( "mc*", 1 );
+    // Tracks are never used by the tools
+    T->SetBranchStatus( "mc.track*", 0 );
+    if( !(parts & MCParticles) ) T->SetBranchStatus( "mc.particle*", 0 );
+    if( !(parts & MCPMTs) )      T->SetBranchStatus( "mc.pmt*", 0 );
+  }
+}
+
+void DSBranchSelector::readAll()
+{
+  T->SetBranchStatus( "*", 1 );
+  parts = Everything;
+}
+
+void DSBranchSelector::report()
+{
+  // A chain reports its current file
+  if( T->GetTree() == nullptr ) T->LoadTree(0);
+  TTree* tree = T->GetTree();
+  if( tree == nullptr ) return;
+  bytesRead = 0;
+  bytesSkipped = 0;
+  TObjArray* branches = tree->GetListOfBranches();
+  for( int i=0; i < branches->GetEntriesFast(); i++ )
+    count( tree, (TBranch*)branches->At(i) );
+  Long64_t total = bytesRead + bytesSkipped;
+  printf("Branch selection reads %lld of %lld bytes, skips %lld (%.1f%%)\n",
+      bytesRead, total, bytesSkipped, total > 0 ? 100.0 * bytesSkipped / total : 0.0);
+}
+
+void DSBranchSelector::count( TTree* tree, TBranch* branch )
+{
+  // Own baskets only, sub-branches are counted on their own
+  Long64_t bytes = branch->GetZipBytes();
+  if( tree->GetBranchStatus( branch->GetName() ) )
+    bytesRead += bytes;
+  else
+    bytesSkipped += bytes;
+  TObjArray* subbranches = branch->GetListOfBranches();
+  for( int i=0; i < subbranches->GetEntriesFast(); i++ )
+    count( tree, (TBranch*)subbranches->At(i) );
+}
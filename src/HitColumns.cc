@@ -0,0 +1,125 @@
+#include <HitColumns.hh>
+#include <RAT/DS/PMT.hh>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+UShort_t floatToHalf( float x )
+{
+  uint32_t f;
+  memcpy( &f, &x, sizeof(f) );
+  uint32_t sign = (f >> 16) & 0x8000;
+  int32_t fexp  = (f >> 23) & 0xff;
+  uint32_t mant = f & 0x7fffff;
+  if( fexp == 0xff )    // inf, nan
+    return sign | 0x7c00 | ( mant ? 0x200 : 0 );
+  int32_t exp = fexp - 127 + 15;
+  if( exp >= 31 )       // too large, inf
+    return sign | 0x7c00;
+  if( exp <= 0 )
+  {
+    // Subnormal or zero
+    if( exp < -10 ) return sign;
+    mant |= 0x800000;
+    int shift = 14 - exp;
+    uint32_t h = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if( rem > halfway || ( rem == halfway && (h & 1) ) ) h++;
+    return sign | h;
+  }
+  uint32_t h = (exp << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1fff;
+  // A carry out of the mantissa steps the exponent, up to inf
+  if( rem > 0x1000 || ( rem == 0x1000 && (h & 1) ) ) h++;
+  return sign | h;
+}
+
+float halfToFloat( UShort_t h )
+{
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exp  = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  uint32_t f;
+  if( exp == 0 )
+  {
+    if( mant == 0 )
+      f = sign;
+    else
+    {
+      // Subnormal, normalize
+      exp = 127 - 15 + 1;
+      while( !(mant & 0x400) )
+      {
+        mant <<= 1;
+        exp--;
+      }
+      f = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  }
+  else if( exp == 31 )
+    f = sign | 0x7f800000 | (mant << 13);
+  else
+    f = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  float x;
+  memcpy( &x, &f, sizeof(x) );
+  return x;
+}
+
+HitColumns::HitColumns()
+{
+  cleardata();
+}
+
+void HitColumns::cleardata()
+{
+  pmt.clear();
+  time.clear();
+  charge.clear();
+  offset.clear();
+  offset.push_back(0);
+}
+
+void HitColumns::addEV( RAT::DS::EV* ev )
+{
+  for( int pmtc=0; pmtc < ev->GetPMTCount(); pmtc++ )
+  {
+    RAT::DS::PMT* hit = ev->GetPMT(pmtc);
+    int id = hit->GetID();
+    if( id < 0 || id > 65535 )
+    {
+      std::cerr << "PMT ID " << id << " does not fit the 16 bit hit columns" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    pmt.push_back( id );
+    time.push_back( floatToHalf( hit->GetTime() ) );
+    charge.push_back( floatToHalf( hit->GetCharge() ) );
+  }
+  offset.push_back( pmt.size() );
+}
+
+void HitColumns::NewBranches( NtupleOutput* t )
+{
+  t->Branch("hitpmt", &pmt);
+  t->Branch("hittime", &time);
+  t->Branch("hitcharge", &charge);
+  t->Branch("hitoffset", &offset);
+}
+
+void HitColumns::SetBranches( TTree* t )
+{
+  // Vector branches take the address of a pointer, and keep using it
+  t->SetBranchAddress("hitpmt", pointers.hold(&pmt));
+  t->SetBranchAddress("hittime", pointers.hold(&time));
+  t->SetBranchAddress("hitcharge", pointers.hold(&charge));
+  t->SetBranchAddress("hitoffset", pointers.hold(&offset));
+}
+
+void HitColumns::SetBranches( NtupleReader* t )
+{
+  t->SetBranchAddress("hitpmt", &pmt);
+  t->SetBranchAddress("hittime", &time);
+  t->SetBranchAddress("hitcharge", &charge);
+  t->SetBranchAddress("hitoffset", &offset);
+}
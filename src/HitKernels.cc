@@ -0,0 +1,548 @@
+#include <HitKernels.hh>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HITKERNELS_X86
+#endif
+
+void HitArrays::stage( RAT::DS::EV* ev, const std::vector<int>& typeById )
+{
+  int n = ev->GetPMTCount();
+  time.resize( n );
+  charge.resize( n );
+  id.resize( n );
+  type.resize( n );
+  for( int i=0; i < n; i++ )
+  {
+    RAT::DS::PMT* pmt = ev->GetPMT(i);
+    time[i]   = pmt->GetTime();
+    charge[i] = pmt->GetCharge();
+    id[i]     = pmt->GetID();
+    type[i]   = typeById[ id[i] ];
+  }
+}
+
+namespace
+{
+  // Scalar reference versions, also used for the vector loop tails
+  int countScalar( const float* t, const int* ty, int begin, int n, float minT, float maxT, int type )
+  {
+    int count = 0;
+    for( int i=begin; i < n; i++ )
+      count += ( ty[i] == type ) & ( t[i] > minT ) & ( t[i] < maxT );
+    return count;
+  }
+
+  void statsScalar( const float* q, const int* ty, int begin, int n, int type, ChargeStats& s )
+  {
+    for( int i=begin; i < n; i++ )
+    {
+      if( ty[i] != type ) continue;
+      s.sum   += q[i];
+      s.sumsq += double(q[i]) * q[i];
+      if( q[i] > s.max ) s.max = q[i];
+    }
+  }
+
+  int countWindowScalar( const HitArrays& h, float minT, float maxT, int type )
+  {
+    return countScalar( h.time.data(), h.type.data(), 0, h.size(), minT, maxT, type );
+  }
+
+  ChargeStats chargeStatsScalar( const HitArrays& h, int type )
+  {
+    ChargeStats s = { 0, 0, 0 };
+    statsScalar( h.charge.data(), h.type.data(), 0, h.size(), type, s );
+    return s;
+  }
+
+  // Fused windows and stats over hits begin .. n-1, added to counts and s
+  void summarizeTail( const HitArrays& h, int begin, const std::vector<WindowCut>& windows,
+      std::vector<int>& counts, std::vector<ChargeStats>& stats )
+  {
+    const float* t = h.time.data();
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n  = h.size();
+    int nw = windows.size();
+    int ns = stats.size();
+    for( int i=begin; i < n; i++ )
+    {
+      for( int k=0; k < nw; k++ )
+      {
+        const WindowCut& w = windows[k];
+        counts[k] += ( ty[i] == w.type ) & ( t[i] > w.minT ) & ( t[i] < w.maxT );
+      }
+      if( ty[i] < 0 || ty[i] >= ns ) continue;
+      ChargeStats& s = stats[ ty[i] ];
+      s.sum   += q[i];
+      s.sumsq += double(q[i]) * q[i];
+      if( q[i] > s.max ) s.max = q[i];
+    }
+  }
+
+  void summarizeScalar( const HitArrays& h, const std::vector<WindowCut>& windows,
+      std::vector<int>& counts, std::vector<ChargeStats>& stats )
+  {
+    ChargeStats zero = { 0, 0, 0 };
+    std::fill( counts.begin(), counts.end(), 0 );
+    std::fill( stats.begin(), stats.end(), zero );
+    summarizeTail( h, 0, windows, counts, stats );
+  }
+
+#ifdef HITKERNELS_X86
+  __attribute__((target("sse4.1,popcnt")))
+  int countWindowSSE( const HitArrays& h, float minT, float maxT, int type )
+  {
+    const float* t = h.time.data();
+    const int* ty  = h.type.data();
+    int n = h.size();
+    __m128 lo  = _mm_set1_ps( minT );
+    __m128 hi  = _mm_set1_ps( maxT );
+    __m128i tt = _mm_set1_epi32( type );
+    int count = 0;
+    int i = 0;
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 time = _mm_loadu_ps( t + i );
+      __m128 in   = _mm_and_ps( _mm_cmpgt_ps( time, lo ), _mm_cmplt_ps( time, hi ) );
+      __m128 same = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i*)(ty + i) ), tt ) );
+      count += _mm_popcnt_u32( _mm_movemask_ps( _mm_and_ps( in, same ) ) );
+    }
+    return count + countScalar( t, ty, i, n, minT, maxT, type );
+  }
+
+  __attribute__((target("sse4.1")))
+  ChargeStats chargeStatsSSE( const HitArrays& h, int type )
+  {
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n = h.size();
+    __m128i tt  = _mm_set1_epi32( type );
+    __m128d sum = _mm_setzero_pd();
+    __m128d sq  = _mm_setzero_pd();
+    __m128 mx   = _mm_setzero_ps();
+    int i = 0;
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 same = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i*)(ty + i) ), tt ) );
+      __m128 c    = _mm_and_ps( _mm_loadu_ps( q + i ), same );
+      __m128d c0  = _mm_cvtps_pd( c );
+      __m128d c1  = _mm_cvtps_pd( _mm_movehl_ps( c, c ) );
+      sum = _mm_add_pd( sum, _mm_add_pd( c0, c1 ) );
+      sq  = _mm_add_pd( sq, _mm_add_pd( _mm_mul_pd( c0, c0 ), _mm_mul_pd( c1, c1 ) ) );
+      mx  = _mm_max_ps( mx, c );
+    }
+    double dsum[2], dsq[2];
+    float fmx[4];
+    _mm_storeu_pd( dsum, sum );
+    _mm_storeu_pd( dsq, sq );
+    _mm_storeu_ps( fmx, mx );
+    ChargeStats s;
+    s.sum   = dsum[0] + dsum[1];
+    s.sumsq = dsq[0] + dsq[1];
+    s.max   = std::max( std::max( fmx[0], fmx[1] ), std::max( fmx[2], fmx[3] ) );
+    statsScalar( q, ty, i, n, type, s );
+    return s;
+  }
+
+  __attribute__((target("sse4.1,popcnt")))
+  void summarizeSSE( const HitArrays& h, const std::vector<WindowCut>& windows,
+      std::vector<int>& counts, std::vector<ChargeStats>& stats )
+  {
+    int ns = stats.size();
+    if( ns > HitKernels::maxTypes )
+      return summarizeScalar( h, windows, counts, stats );
+    const float* t = h.time.data();
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n  = h.size();
+    int nw = windows.size();
+    std::fill( counts.begin(), counts.end(), 0 );
+    __m128d sum[HitKernels::maxTypes], sq[HitKernels::maxTypes];
+    __m128 mx[HitKernels::maxTypes];
+    for( int s=0; s < ns; s++ )
+    {
+      sum[s] = _mm_setzero_pd();
+      sq[s]  = _mm_setzero_pd();
+      mx[s]  = _mm_setzero_ps();
+    }
+    int i = 0;
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 time = _mm_loadu_ps( t + i );
+      __m128i typ = _mm_loadu_si128( (const __m128i*)(ty + i) );
+      __m128 c    = _mm_loadu_ps( q + i );
+      for( int k=0; k < nw; k++ )
+      {
+        const WindowCut& w = windows[k];
+        __m128 in   = _mm_and_ps( _mm_cmpgt_ps( time, _mm_set1_ps( w.minT ) ),
+                                  _mm_cmplt_ps( time, _mm_set1_ps( w.maxT ) ) );
+        __m128 same = _mm_castsi128_ps( _mm_cmpeq_epi32( typ, _mm_set1_epi32( w.type ) ) );
+        counts[k] += _mm_popcnt_u32( _mm_movemask_ps( _mm_and_ps( in, same ) ) );
+      }
+      for( int s=0; s < ns; s++ )
+      {
+        __m128 same = _mm_castsi128_ps( _mm_cmpeq_epi32( typ, _mm_set1_epi32( s ) ) );
+        __m128 cs   = _mm_and_ps( c, same );
+        __m128d c0  = _mm_cvtps_pd( cs );
+        __m128d c1  = _mm_cvtps_pd( _mm_movehl_ps( cs, cs ) );
+        sum[s] = _mm_add_pd( sum[s], _mm_add_pd( c0, c1 ) );
+        sq[s]  = _mm_add_pd( sq[s], _mm_add_pd( _mm_mul_pd( c0, c0 ), _mm_mul_pd( c1, c1 ) ) );
+        mx[s]  = _mm_max_ps( mx[s], cs );
+      }
+    }
+    for( int s=0; s < ns; s++ )
+    {
+      double dsum[2], dsq[2];
+      float fmx[4];
+      _mm_storeu_pd( dsum, sum[s] );
+      _mm_storeu_pd( dsq, sq[s] );
+      _mm_storeu_ps( fmx, mx[s] );
+      stats[s].sum   = dsum[0] + dsum[1];
+      stats[s].sumsq = dsq[0] + dsq[1];
+      stats[s].max   = std::max( std::max( fmx[0], fmx[1] ), std::max( fmx[2], fmx[3] ) );
+    }
+    summarizeTail( h, i, windows, counts, stats );
+  }
+
+  __attribute__((target("avx2,popcnt")))
+  int countWindowAVX2( const HitArrays& h, float minT, float maxT, int type )
+  {
+    const float* t = h.time.data();
+    const int* ty  = h.type.data();
+    int n = h.size();
+    __m256 lo  = _mm256_set1_ps( minT );
+    __m256 hi  = _mm256_set1_ps( maxT );
+    __m256i tt = _mm256_set1_epi32( type );
+    int count = 0;
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 )
+    {
+      __m256 time = _mm256_loadu_ps( t + i );
+      __m256 in   = _mm256_and_ps( _mm256_cmp_ps( time, lo, _CMP_GT_OQ ),
+                                   _mm256_cmp_ps( time, hi, _CMP_LT_OQ ) );
+      __m256 same = _mm256_castsi256_ps( _mm256_cmpeq_epi32(
+            _mm256_loadu_si256( (const __m256i*)(ty + i) ), tt ) );
+      count += _mm_popcnt_u32( _mm256_movemask_ps( _mm256_and_ps( in, same ) ) );
+    }
+    return count + countScalar( t, ty, i, n, minT, maxT, type );
+  }
+
+  __attribute__((target("avx2")))
+  ChargeStats chargeStatsAVX2( const HitArrays& h, int type )
+  {
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n = h.size();
+    __m256i tt  = _mm256_set1_epi32( type );
+    __m256d sum = _mm256_setzero_pd();
+    __m256d sq  = _mm256_setzero_pd();
+    __m256 mx   = _mm256_setzero_ps();
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 )
+    {
+      __m256 same = _mm256_castsi256_ps( _mm256_cmpeq_epi32(
+            _mm256_loadu_si256( (const __m256i*)(ty + i) ), tt ) );
+      __m256 c    = _mm256_and_ps( _mm256_loadu_ps( q + i ), same );
+      __m256d c0  = _mm256_cvtps_pd( _mm256_castps256_ps128( c ) );
+      __m256d c1  = _mm256_cvtps_pd( _mm256_extractf128_ps( c, 1 ) );
+      sum = _mm256_add_pd( sum, _mm256_add_pd( c0, c1 ) );
+      sq  = _mm256_add_pd( sq, _mm256_add_pd( _mm256_mul_pd( c0, c0 ), _mm256_mul_pd( c1, c1 ) ) );
+      mx  = _mm256_max_ps( mx, c );
+    }
+    double dsum[4], dsq[4];
+    float fmx[8];
+    _mm256_storeu_pd( dsum, sum );
+    _mm256_storeu_pd( dsq, sq );
+    _mm256_storeu_ps( fmx, mx );
+    ChargeStats s;
+    s.sum   = (dsum[0] + dsum[1]) + (dsum[2] + dsum[3]);
+    s.sumsq = (dsq[0] + dsq[1]) + (dsq[2] + dsq[3]);
+    s.max   = *std::max_element( fmx, fmx + 8 );
+    statsScalar( q, ty, i, n, type, s );
+    return s;
+  }
+
+  __attribute__((target("avx2,popcnt")))
+  void summarizeAVX2( const HitArrays& h, const std::vector<WindowCut>& windows,
+      std::vector<int>& counts, std::vector<ChargeStats>& stats )
+  {
+    int ns = stats.size();
+    if( ns > HitKernels::maxTypes )
+      return summarizeScalar( h, windows, counts, stats );
+    const float* t = h.time.data();
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n  = h.size();
+    int nw = windows.size();
+    std::fill( counts.begin(), counts.end(), 0 );
+    __m256d sum[HitKernels::maxTypes], sq[HitKernels::maxTypes];
+    __m256 mx[HitKernels::maxTypes];
+    for( int s=0; s < ns; s++ )
+    {
+      sum[s] = _mm256_setzero_pd();
+      sq[s]  = _mm256_setzero_pd();
+      mx[s]  = _mm256_setzero_ps();
+    }
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 )
+    {
+      __m256 time = _mm256_loadu_ps( t + i );
+      __m256i typ = _mm256_loadu_si256( (const __m256i*)(ty + i) );
+      __m256 c    = _mm256_loadu_ps( q + i );
+      for( int k=0; k < nw; k++ )
+      {
+        const WindowCut& w = windows[k];
+        __m256 in   = _mm256_and_ps( _mm256_cmp_ps( time, _mm256_set1_ps( w.minT ), _CMP_GT_OQ ),
+                                     _mm256_cmp_ps( time, _mm256_set1_ps( w.maxT ), _CMP_LT_OQ ) );
+        __m256 same = _mm256_castsi256_ps( _mm256_cmpeq_epi32( typ, _mm256_set1_epi32( w.type ) ) );
+        counts[k] += _mm_popcnt_u32( _mm256_movemask_ps( _mm256_and_ps( in, same ) ) );
+      }
+      for( int s=0; s < ns; s++ )
+      {
+        __m256 same = _mm256_castsi256_ps( _mm256_cmpeq_epi32( typ, _mm256_set1_epi32( s ) ) );
+        __m256 cs   = _mm256_and_ps( c, same );
+        __m256d c0  = _mm256_cvtps_pd( _mm256_castps256_ps128( cs ) );
+        __m256d c1  = _mm256_cvtps_pd( _mm256_extractf128_ps( cs, 1 ) );
+        sum[s] = _mm256_add_pd( sum[s], _mm256_add_pd( c0, c1 ) );
+        sq[s]  = _mm256_add_pd( sq[s], _mm256_add_pd( _mm256_mul_pd( c0, c0 ), _mm256_mul_pd( c1, c1 ) ) );
+        mx[s]  = _mm256_max_ps( mx[s], cs );
+      }
+    }
+    for( int s=0; s < ns; s++ )
+    {
+      double dsum[4], dsq[4];
+      float fmx[8];
+      _mm256_storeu_pd( dsum, sum[s] );
+      _mm256_storeu_pd( dsq, sq[s] );
+      _mm256_storeu_ps( fmx, mx[s] );
+      stats[s].sum   = (dsum[0] + dsum[1]) + (dsum[2] + dsum[3]);
+      stats[s].sumsq = (dsq[0] + dsq[1]) + (dsq[2] + dsq[3]);
+      stats[s].max   = *std::max_element( fmx, fmx + 8 );
+    }
+    summarizeTail( h, i, windows, counts, stats );
+  }
+
+  // GCC's _mm512_reduce_* expand to extracts from undefined registers,
+  // which -Wall reports as maybe uninitialized
+  __attribute__((target("avx512f")))
+  double addLanes( __m512d x )
+  {
+    double d[8];
+    _mm512_storeu_pd( d, x );
+    return ((d[0] + d[1]) + (d[2] + d[3])) + ((d[4] + d[5]) + (d[6] + d[7]));
+  }
+
+  __attribute__((target("avx512f")))
+  float maxLanes( __m512 x )
+  {
+    float f[16];
+    _mm512_storeu_ps( f, x );
+    return *std::max_element( f, f + 16 );
+  }
+
+  __attribute__((target("avx512f,popcnt")))
+  int countWindowAVX512( const HitArrays& h, float minT, float maxT, int type )
+  {
+    const float* t = h.time.data();
+    const int* ty  = h.type.data();
+    int n = h.size();
+    __m512 lo  = _mm512_set1_ps( minT );
+    __m512 hi  = _mm512_set1_ps( maxT );
+    __m512i tt = _mm512_set1_epi32( type );
+    int count = 0;
+    int i = 0;
+    for( ; i + 16 <= n; i += 16 )
+    {
+      __m512 time = _mm512_loadu_ps( t + i );
+      __mmask16 m = _mm512_cmp_ps_mask( time, lo, _CMP_GT_OQ );
+      m = _mm512_mask_cmp_ps_mask( m, time, hi, _CMP_LT_OQ );
+      m = _mm512_mask_cmpeq_epi32_mask( m, _mm512_loadu_si512( ty + i ), tt );
+      count += _mm_popcnt_u32( m );
+    }
+    return count + countScalar( t, ty, i, n, minT, maxT, type );
+  }
+
+  __attribute__((target("avx512f")))
+  ChargeStats chargeStatsAVX512( const HitArrays& h, int type )
+  {
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n = h.size();
+    __m512i tt  = _mm512_set1_epi32( type );
+    __m512d sum = _mm512_setzero_pd();
+    __m512d sq  = _mm512_setzero_pd();
+    __m512 mx   = _mm512_setzero_ps();
+    int i = 0;
+    for( ; i + 16 <= n; i += 16 )
+    {
+      __mmask16 same = _mm512_cmpeq_epi32_mask( _mm512_loadu_si512( ty + i ), tt );
+      // Each half widened straight from memory under its mask; the
+      // unmasked casts and conversions leave lanes undefined
+      __m512d c0  = _mm512_maskz_cvtps_pd( (__mmask8)same, _mm256_loadu_ps( q + i ) );
+      __m512d c1  = _mm512_maskz_cvtps_pd( (__mmask8)(same >> 8), _mm256_loadu_ps( q + i + 8 ) );
+      sum = _mm512_add_pd( sum, _mm512_add_pd( c0, c1 ) );
+      sq  = _mm512_add_pd( sq, _mm512_add_pd( _mm512_mul_pd( c0, c0 ), _mm512_mul_pd( c1, c1 ) ) );
+      mx  = _mm512_mask_max_ps( mx, same, mx, _mm512_loadu_ps( q + i ) );
+    }
+    ChargeStats s;
+    s.sum   = addLanes( sum );
+    s.sumsq = addLanes( sq );
+    s.max   = maxLanes( mx );
+    statsScalar( q, ty, i, n, type, s );
+    return s;
+  }
+
+  __attribute__((target("avx512f,popcnt")))
+  void summarizeAVX512( const HitArrays& h, const std::vector<WindowCut>& windows,
+      std::vector<int>& counts, std::vector<ChargeStats>& stats )
+  {
+    int ns = stats.size();
+    if( ns > HitKernels::maxTypes )
+      return summarizeScalar( h, windows, counts, stats );
+    const float* t = h.time.data();
+    const float* q = h.charge.data();
+    const int* ty  = h.type.data();
+    int n  = h.size();
+    int nw = windows.size();
+    std::fill( counts.begin(), counts.end(), 0 );
+    __m512d sum[HitKernels::maxTypes], sq[HitKernels::maxTypes];
+    __m512 mx[HitKernels::maxTypes];
+    for( int s=0; s < ns; s++ )
+    {
+      sum[s] = _mm512_setzero_pd();
+      sq[s]  = _mm512_setzero_pd();
+      mx[s]  = _mm512_setzero_ps();
+    }
+    int i = 0;
+    for( ; i + 16 <= n; i += 16 )
+    {
+      __m512 time = _mm512_loadu_ps( t + i );
+      __m512i typ = _mm512_loadu_si512( ty + i );
+      __m512 c    = _mm512_loadu_ps( q + i );
+      __m256 clo  = _mm256_loadu_ps( q + i );
+      __m256 chi  = _mm256_loadu_ps( q + i + 8 );
+      for( int k=0; k < nw; k++ )
+      {
+        const WindowCut& w = windows[k];
+        __mmask16 m = _mm512_cmp_ps_mask( time, _mm512_set1_ps( w.minT ), _CMP_GT_OQ );
+        m = _mm512_mask_cmp_ps_mask( m, time, _mm512_set1_ps( w.maxT ), _CMP_LT_OQ );
+        m = _mm512_mask_cmpeq_epi32_mask( m, typ, _mm512_set1_epi32( w.type ) );
+        counts[k] += _mm_popcnt_u32( m );
+      }
+      for( int s=0; s < ns; s++ )
+      {
+        __mmask16 same = _mm512_cmpeq_epi32_mask( typ, _mm512_set1_epi32( s ) );
+        __m512d c0 = _mm512_maskz_cvtps_pd( (__mmask8)same, clo );
+        __m512d c1 = _mm512_maskz_cvtps_pd( (__mmask8)(same >> 8), chi );
+        sum[s] = _mm512_add_pd( sum[s], _mm512_add_pd( c0, c1 ) );
+        sq[s]  = _mm512_add_pd( sq[s], _mm512_add_pd( _mm512_mul_pd( c0, c0 ), _mm512_mul_pd( c1, c1 ) ) );
+        mx[s]  = _mm512_mask_max_ps( mx[s], same, mx[s], c );
+      }
+    }
+    for( int s=0; s < ns; s++ )
+    {
+      stats[s].sum   = addLanes( sum[s] );
+      stats[s].sumsq = addLanes( sq[s] );
+      stats[s].max   = maxLanes( mx[s] );
+    }
+    summarizeTail( h, i, windows, counts, stats );
+  }
+#endif
+
+  typedef int (*CountFunction)( const HitArrays&, float, float, int );
+  typedef ChargeStats (*StatsFunction)( const HitArrays&, int );
+  typedef void (*SummarizeFunction)( const HitArrays&, const std::vector<WindowCut>&,
+      std::vector<int>&, std::vector<ChargeStats>& );
+
+  class Dispatch
+  {
+    public:
+      Dispatch()
+      {
+        use( "scalar" );
+        // The requested variant or the widest below it the CPU supports
+        const char* order[] = { "avx512f", "avx2", "sse4.1", "scalar" };
+        const char* forced = getenv("HITKERNELS_ISA");
+        std::string want = forced ? forced : "avx512f";
+        int first = 0;
+        for( int k=0; k < 4; k++ )
+          if( want == order[k] ) first = k;
+        for( int k=first; k < 4; k++ )
+          if( use( order[k] ) ) break;
+      }
+
+      bool use( const std::string& isa )
+      {
+        if( isa == "scalar" )
+        {
+          name = "scalar"; count = countWindowScalar; stats = chargeStatsScalar;
+          summarize = summarizeScalar;
+          return true;
+        }
+#ifdef HITKERNELS_X86
+        __builtin_cpu_init();
+        bool popcnt = __builtin_cpu_supports("popcnt");
+        if( isa == "avx512f" && popcnt && __builtin_cpu_supports("avx512f") )
+        {
+          name = "avx512f"; count = countWindowAVX512; stats = chargeStatsAVX512;
+          summarize = summarizeAVX512;
+          return true;
+        }
+        if( isa == "avx2" && popcnt && __builtin_cpu_supports("avx2") )
+        {
+          name = "avx2"; count = countWindowAVX2; stats = chargeStatsAVX2;
+          summarize = summarizeAVX2;
+          return true;
+        }
+        if( isa == "sse4.1" && popcnt && __builtin_cpu_supports("sse4.1") )
+        {
+          name = "sse4.1"; count = countWindowSSE; stats = chargeStatsSSE;
+          summarize = summarizeSSE;
+          return true;
+        }
+#endif
+        return false;
+      }
+      const char* name;
+      CountFunction count;
+      StatsFunction stats;
+      SummarizeFunction summarize;
+  };
+
+  Dispatch& dispatch()
+  {
+    static Dispatch d;
+    return d;
+  }
+}
+
+void HitKernels::summarize( const HitArrays& hits, const std::vector<WindowCut>& windows,
+    std::vector<int>& counts, std::vector<ChargeStats>& stats )
+{
+  dispatch().summarize( hits, windows, counts, stats );
+}
+
+int HitKernels::countWindow( const HitArrays& hits, float minT, float maxT, int type )
+{
+  return dispatch().count( hits, minT, maxT, type );
+}
+
+ChargeStats HitKernels::chargeStats( const HitArrays& hits, int type )
+{
+  return dispatch().stats( hits, type );
+}
+
+const char* HitKernels::isa()
+{
+  return dispatch().name;
+}
+
+bool HitKernels::select( const std::string& name )
+{
+  return dispatch().use( name );
+}
@@ -0,0 +1,42 @@
+#include <HitSummary.hh>
+#include <algorithm>
+
+HitSummary::HitSummary( PMTGeometry* geometry ) :
+  geometry(geometry)
+{
+  int maxtype = 0;
+  for( auto t : geometry->type )
+    maxtype = std::max( maxtype, t );
+  stats.resize( maxtype + 1 );
+}
+
+int HitSummary::addWindow( std::string name, double minT, double maxT, int type )
+{
+  windows.push_back( HitWindow( name, minT, maxT, type ) );
+  WindowCut cut = { float(minT), float(maxT), type };
+  cuts.push_back( cut );
+  counts.push_back( 0 );
+  return windows.size() - 1;
+}
+
+void HitSummary::process( RAT::DS::EV* ev )
+{
+  staged.stage( ev, geometry->type );
+  HitKernels::summarize( staged, cuts, counts, stats );
+}
+
+double HitSummary::charge( int type )
+{
+  return ( type >= 0 && type < int(stats.size()) ) ? stats[type].sum : 0.0;
+}
+
+double HitSummary::maxCharge( int type )
+{
+  return ( type >= 0 && type < int(stats.size()) ) ? stats[type].max : 0.0;
+}
+
+ChargeStats HitSummary::typeStats( int type )
+{
+  ChargeStats none = { 0, 0, 0 };
+  return ( type >= 0 && type < int(stats.size()) ) ? stats[type] : none;
+}
@@ -0,0 +1,84 @@
+#include <MergedIndex.hh>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+MergedIndex::MergedIndex( std::string fname ) :
+  fname(fname), ds(nullptr)
+{
+  tfile = TFile::Open( fname.c_str(), "read" );
+  if( tfile == nullptr || tfile->IsZombie() )
+  {
+    std::cerr << "Cannot open " << fname << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  TTree* index = (TTree*)tfile->Get("index");
+  if( index == nullptr )
+  {
+    std::cerr << fname << " has no index tree, remerge it to add one" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  ULong64_t rtime;
+  Long64_t rentry;
+  int rcomponent;
+  double rx, ry, rz;
+  index->SetBranchAddress("nanotime", &rtime);
+  index->SetBranchAddress("entry", &rentry);
+  index->SetBranchAddress("component", &rcomponent);
+  index->SetBranchAddress("x", &rx);
+  index->SetBranchAddress("y", &ry);
+  index->SetBranchAddress("z", &rz);
+  Long64_t rows = index->GetEntries();
+  nanotime.reserve( rows );
+  entry.reserve( rows );
+  component.reserve( rows );
+  x.reserve( rows );
+  y.reserve( rows );
+  z.reserve( rows );
+  for( Long64_t i=0; i < rows; i++ )
+  {
+    index->GetEntry(i);
+    nanotime.push_back( rtime );
+    entry.push_back( rentry );
+    component.push_back( rcomponent );
+    x.push_back( rx );
+    y.push_back( ry );
+    z.push_back( rz );
+  }
+  index->ResetBranchAddresses();
+  ttree = (TTree*)tfile->Get("T");
+  ds = new RAT::DS::Root();
+  ttree->SetBranchAddress( "ds", &ds );
+}
+
+MergedIndex::~MergedIndex()
+{
+  tfile->Close();
+  delete tfile;
+  delete ds;
+}
+
+std::pair<size_t, size_t> MergedIndex::window( double tmin, double tmax )
+{
+  ULong64_t lo = tmin > 0 ? static_cast<ULong64_t>( llround( tmin * 1e9 ) ) : 0;
+  ULong64_t hi = tmax > 0 ? static_cast<ULong64_t>( llround( tmax * 1e9 ) ) : 0;
+  size_t first = std::lower_bound( nanotime.begin(), nanotime.end(), lo ) - nanotime.begin();
+  size_t last  = std::lower_bound( nanotime.begin() + first, nanotime.end(), hi ) - nanotime.begin();
+  return std::make_pair( first, last );
+}
+
+std::vector<Long64_t> MergedIndex::entries( double tmin, double tmax )
+{
+  // Reused events can appear several times in a window
+  std::pair<size_t, size_t> rows = window( tmin, tmax );
+  std::vector<Long64_t> matched( entry.begin() + rows.first, entry.begin() + rows.second );
+  std::sort( matched.begin(), matched.end() );
+  matched.erase( std::unique( matched.begin(), matched.end() ), matched.end() );
+  return matched;
+}
+
+RAT::DS::Root* MergedIndex::load( size_t row )
+{
+  ttree->GetEntry( entry[row] );
+  return ds;
+}
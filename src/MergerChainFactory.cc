@@ -1,11 +1,19 @@
 #include <MergerChainFactory.hh>
+#include <MergerEventCache.hh>
+#include <MergerPrefetcher.hh>
 #include <iostream>
 #include <map>
 #include <cmath>
 #include <algorithm>
 #include <utility>
+#include <set>
+#include <chrono>
+#include <unistd.h>
+#include <cstdio>
 #include <boost/filesystem.hpp>
 #include <TChain.h>
+#include <TMemFile.h>
+#include <TTreeCache.h>
 #include <TTimeStamp.h>
 
 // Factory manages each component of the model, pointing to a list of Chains
@@ -24,20 +32,32 @@ MergerChainFactory::MergerChainFactory( MergerConfig* _config, TRandom3* rndm, b
     std::string chaindir = config->baseDir + "/" + mcc->dir;
     std::vector<std::string> rootfiles = listDir( chaindir );
     chainList.push_back( new MergerTChain( config->dstree, config->dsbranch, 
-          mcc->name, rootfiles, mcc->rate, mcc->is_single, rndm ) );
+          mcc->name, rootfiles, mcc->rate, mcc->is_single, rndm,
+          mcc->selection, config->aliases ) );
+    chainList.back()->scan = mcc->scan;
+    chainList.back()->reuse = mcc->reuse;
     this->LastFileName = rootfiles[0];
   }
-  this->bufferTC = std::make_pair(-100, 0);
-  this->bufferTimePrev = -1000;
-  this->bufferXPrev = 9999999;
-  this->bufferYPrev = 9999999;
-  this->bufferZPrev = 9999999;
-  this->doubleBufferXPrev = 2*bufferXPrev;
-  this->doubleBufferYPrev = 2*bufferYPrev;
-  this->doubleBufferZPrev = 2*bufferZPrev;
-  this->bufferFileIndex = 0;
-  this->bufferEvtIndex = 0;
+  // A rate scan samples at the highest requested rate and thins down
+  this->rateScale = -1;
+  if( config->rateScan.size() > 0 )
+  {
+    double maxscale = *std::max_element( config->rateScan.begin(), config->rateScan.end() );
+    for( auto cl : chainList )
+    {
+      if( cl->scan ) cl->rate *= maxscale;
+    }
+  }
+  resetSelection();
+  this->replaying = false;
+  this->coincidenceOnly = false;
+  resetCounts();
   this->timenow = 0;
+  this->outFile = nullptr;
+  this->outTree = nullptr;
+  this->outDS = nullptr;
+  this->outOccurrences = nullptr;
+  this->outIndex = nullptr;
   this->time_window = config->deltat;
   this->pos_window = config->deltar;
   for( auto cl : chainList )
@@ -53,11 +73,42 @@ MergerChainFactory::~MergerChainFactory()
   this->chainList.clear();
 }
 
+void MergerChainFactory::resetSelection()
+{
+  this->bufferTC = std::make_pair(-100, 0);
+  this->bufferTimePrev = -1000;
+  this->bufferXPrev = 9999999;
+  this->bufferYPrev = 9999999;
+  this->bufferZPrev = 9999999;
+  this->doubleBufferXPrev = 2*bufferXPrev;
+  this->doubleBufferYPrev = 2*bufferYPrev;
+  this->doubleBufferZPrev = 2*bufferZPrev;
+  this->bufferFileIndex = 0;
+  this->bufferEvtIndex = 0;
+}
+
 double MergerChainFactory::nextEvent()
+{
+  RawPick pick = samplePick();
+  return selectPick(pick);
+}
+
+double MergerChainFactory::nextRawEvent()
+{
+  // Sample only; the coincidence selection is replayed later
+  RawPick pick = samplePick();
+  rawTimeline.push_back( pick );
+  // The selection only runs when the timeline is replayed, so every pick
+  // is read ahead; in a sweep the caller does so for the other targets
+  prefetchPick( pick );
+  timenow = pick.time;
+  return timenow;
+}
+
+RawPick MergerChainFactory::samplePick()
 {
   // Choose what the next event will be, but do not access it yet
   // We must build a map of < component, vector<time> >
-  std::map<double, MergerTChain*> order;
   std::map<double, int> timeIndex;
   // Loop through the chain and get the "next" event of each.
   for(int cl=0; cl<chainList.size(); cl++)
@@ -65,18 +116,34 @@ double MergerChainFactory::nextEvent()
     auto mtc = chainList[cl];
     double u = this->rndm->Rndm();
     double poissontime     = -log(1-u)/( mtc->rate * mtc->efficiency );
-    order[poissontime]     = mtc;
     timeIndex[poissontime] = cl;
   }
   // Of the "next" possible events, choose the soonest
-  nextChain = order.begin()->second;
-  timenow += order.begin()->first;
+  RawPick pick;
+  pick.time      = timenow + timeIndex.begin()->first;
+  pick.component = timeIndex.begin()->second;
+  // Which file and event it will be, resolved by the chain
+  pick.ufile     = rndm->Rndm();
+  pick.uevt      = rndm->Rndm();
+  pick.ukeep     = rndm->Rndm();
+  return pick;
+}
+
+void MergerChainFactory::prefetchPick(const RawPick& pick)
+{
+  chainList[pick.component]->prefetchEvent( pick.ufile, pick.uevt );
+}
+
+double MergerChainFactory::selectPick(RawPick& pick)
+{
+  nextChain = chainList[pick.component];
+  timenow = pick.time;
   // Decide what to do with the last buffer (write or throw)
   // << Timing information
   double lookback    = this->bufferTC.first - bufferTimePrev;
   double lookforward = timenow - this->bufferTC.first;
   // << Position information
-  nextChain->getRandomEvent(); // This sets the MergerTChain file_index and evt_index
+  nextChain->pickEvent(pick.ufile, pick.uevt); // This sets the MergerTChain file_index and evt_index
   double pforward = sqrt( pow( nextChain->x - bufferXPrev, 2 ) +
                           pow( nextChain->y - bufferYPrev, 2 ) +
                           pow( nextChain->z - bufferZPrev, 2 ) );
@@ -90,22 +157,12 @@ double MergerChainFactory::nextEvent()
   //      ( (pforward < pos_window) || (pback < pos_window) ) //Position cut
   //     ) || ( !chainList[this->bufferTC.second]->is_single ) // We should also ignore this if the event is a multi
   //    )
-  if ( ( ( (lookback < time_window) && (pback < pos_window) ) ||
-         ( (lookforward < time_window) && (pforward < pos_window) ) ) ||
-       ( !chainList[this->bufferTC.second]->is_single ) )
-  {
-    chainList[ this->bufferTC.second ]->addTime( this->bufferTC.first, 
-        bufferFileIndex, bufferEvtIndex );
-    // printf("Pos: %f, %f -- DT: %f, %f\n", 
-    //     pforward, pback, lookback, lookforward);
-    // printf("\tFile: %i, Evt: %i\n", bufferFileIndex, bufferEvtIndex);
-    // printf("\t(%f, %f, %f)\n", bufferXPrev, bufferYPrev, bufferZPrev);
-    // New method should be addEvent( time, file_index, evt_index );
-    timeComponentMap.insert( bufferTC );
-  }
+  bool coincident = ( ( (lookback < time_window) && (pback < pos_window) ) ||
+                      ( (lookforward < time_window) && (pforward < pos_window) ) );
+  decideBuffer( coincident );
   // Write this event to the buffer
   bufferTimePrev = this->bufferTC.first;
-  this->bufferTC = std::make_pair( timenow, timeIndex.begin()->second );
+  this->bufferTC = std::make_pair( timenow, pick.component );
   // Update two events ago
   doubleBufferXPrev = bufferXPrev;
   doubleBufferYPrev = bufferYPrev;
@@ -119,13 +176,216 @@ double MergerChainFactory::nextEvent()
   return timenow;
 }
 
+void MergerChainFactory::flushSelection()
+{
+  // The last sampled event waits in the buffer for a successor that never
+  // comes; decide it on the look back alone so it is counted too
+  double lookback = this->bufferTC.first - bufferTimePrev;
+  double pback    = sqrt( pow( bufferXPrev - doubleBufferXPrev, 2 ) +
+                          pow( bufferYPrev - doubleBufferYPrev, 2 ) +
+                          pow( bufferZPrev - doubleBufferZPrev, 2 ) );
+  decideBuffer( (lookback < time_window) && (pback < pos_window) );
+  // Back to the placeholder, a second flush does nothing
+  this->bufferTC = std::make_pair(-100, 0);
+}
+
+void MergerChainFactory::decideBuffer(bool coincident)
+{
+  bool multi      = !chainList[this->bufferTC.second]->is_single;
+  // The very first buffer is a placeholder, not a sampled event
+  bool sampled    = this->bufferTC.first >= 0;
+  if( sampled )
+    sampledCount[ this->bufferTC.second ]++;
+  if ( coincident || ( multi && !coincidenceOnly ) )
+  {
+    if( sampled )
+      writtenCount[ this->bufferTC.second ]++;
+    chainList[ this->bufferTC.second ]->addTime( this->bufferTC.first, 
+        bufferFileIndex, bufferEvtIndex );
+    // Only events that are kept are read ahead, dropped singles are not
+    if( sampled && !replaying )
+      chainList[ this->bufferTC.second ]->prefetchEntry( bufferFileIndex, bufferEvtIndex );
+    // printf("Pos: %f, %f -- DT: %f, %f\n", 
+    //     pforward, pback, lookback, lookforward);
+    // printf("\tFile: %i, Evt: %i\n", bufferFileIndex, bufferEvtIndex);
+    // printf("\t(%f, %f, %f)\n", bufferXPrev, bufferYPrev, bufferZPrev);
+    // New method should be addEvent( time, file_index, evt_index );
+    timeComponentMap.insert( bufferTC );
+  }
+  else if( coincidenceOnly && sampled )
+  {
+    // Isolated event, keep only a compact record of it
+    SingleRecord single;
+    single.time      = this->bufferTC.first;
+    single.component = this->bufferTC.second;
+    single.x         = bufferXPrev;
+    single.y         = bufferYPrev;
+    single.z         = bufferZPrev;
+    singles.push_back( single );
+  }
+}
+
+void MergerChainFactory::resetCounts()
+{
+  sampledCount.assign( chainList.size(), 0 );
+  writtenCount.assign( chainList.size(), 0 );
+  singles.clear();
+}
+
+void MergerChainFactory::replayTimeline(double keep)
+{
+  // Independent Poisson thinning of the recorded timeline: every event of
+  // a scanned component survives with probability keep, which is exactly
+  // a Poisson process at keep times the sampled rate. The uniform drawn
+  // with the pick decides, so replays are repeatable and nested.
+  resetSelection();
+  resetCounts();
+  timeComponentMap.clear();
+  replaying = true;
+  for( auto& pick : rawTimeline )
+  {
+    if( keep < 1 && chainList[pick.component]->scan && pick.ukeep >= keep )
+      continue;
+    selectPick( pick );
+  }
+  flushSelection();
+  replaying = false;
+  // The dataset length is that of the sampled timeline, not the last kept event
+  if( rawTimeline.size() > 0 )
+    timenow = rawTimeline.back().time;
+}
+
+bool MergerChainFactory::sameSampling(const MergerChainFactory& other) const
+{
+  if( other.chainList.size() != chainList.size() ) return false;
+  for( int cl=0; cl < chainList.size(); cl++ )
+  {
+    MergerTChain* a = chainList[cl];
+    MergerTChain* b = other.chainList[cl];
+    double ra = a->rate * a->efficiency;
+    double rb = b->rate * b->efficiency;
+    if( a->name != b->name || a->scan != b->scan ||
+        std::fabs( ra - rb ) > 1e-9 * std::max( std::fabs(ra), std::fabs(rb) ) )
+    {
+      std::cerr << "Component " << a->name << ": sampled rate " << ra
+                << " differs from " << b->name << " " << rb << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+void MergerChainFactory::buildRateScan(std::vector<double> scales, std::vector<std::string> fnames)
+{
+  // Every rate point appends its selected events to the chains, so a single
+  // eventBuilder pass reads the union of all points from the inputs
+  double maxscale = *std::max_element( scales.begin(), scales.end() );
+  std::vector< std::map<double, int> > pointMaps;
+  std::vector< std::vector<int> > pointOffsets;
+  std::vector< std::vector<SingleRecord> > pointSingles;
+  std::vector< std::vector<Long64_t> > pointSampled;
+  std::vector< std::vector<Long64_t> > pointWritten;
+  for( auto scale : scales )
+  {
+    std::vector<int> offsets;
+    for( auto mtc : chainList )
+      offsets.push_back( mtc->timeStamps.size() );
+    replayTimeline( scale / maxscale );
+    pointOffsets.push_back( offsets );
+    pointMaps.push_back( timeComponentMap );
+    pointSingles.push_back( singles );
+    pointSampled.push_back( sampledCount );
+    pointWritten.push_back( writtenCount );
+    if( verbose )
+      printf("Rate scale %f: %i events\n", scale, int(timeComponentMap.size()));
+  }
+  buildEvents();
+  for( int k=0; k < scales.size(); k++ )
+  {
+    timeComponentMap = pointMaps[k];
+    mergeCursor = timeComponentMap.begin();
+    for( int cl=0; cl < chainList.size(); cl++ )
+      chainList[cl]->dsitr = chainList[cl]->dsevents.begin() + pointOffsets[k][cl];
+    singles = pointSingles[k];
+    sampledCount = pointSampled[k];
+    writtenCount = pointWritten[k];
+    this->rateScale = scales[k];
+    openNewFile( fnames[k] );
+    MergedEvent evt;
+    while( nextMergedEvent(evt) )
+      fillNewFile(evt);
+    closeNewFile();
+  }
+  this->rateScale = -1;
+  rawTimeline.clear();
+  finishDataset();
+}
+
 void MergerChainFactory::buildNewFile(std::string fname)
+{
+  buildEvents();
+  writeNewFile(fname);
+}
+
+void MergerChainFactory::buildEvents()
 {
   // Build vectors of ds events on each chain
   for( auto mtc : chainList )
   {
     mtc->eventBuilder(verbose=this->verbose);
   }
+  this->mergeCursor = timeComponentMap.begin();
+}
+
+bool MergerChainFactory::nextMergedEvent(MergedEvent& evt)
+{
+  // Pull the next event of the merged timeline, in time order. Events
+  // rejected by a component selection carry no MC and are skipped.
+  while( mergeCursor != timeComponentMap.end() )
+  {
+    double time = mergeCursor->first;
+    int idx = mergeCursor->second;
+    ++mergeCursor;
+    MergerTChain* mtc = chainList[idx];
+    int slot = std::distance( mtc->dsevents.begin(), mtc->dsitr );
+    RAT::DS::Root* ds = &( *(mtc->dsitr) );
+    ++mtc->dsitr;
+    if( !ds->ExistMC() ) continue;
+    // Update the event. Set simulation time to Jan 1st 1970.
+    // Beware ... root sucks ...
+    // Also, uses 32 bit int, so TTimeStamp dies in 1938 -.-
+    time_t seconds = static_cast<time_t>(floor(time));
+    Int_t nanoseconds = static_cast<Int_t>( (time - seconds)*1e9 );
+    TTimeStamp mctime(seconds, nanoseconds);
+    ds->GetMC()->SetUTC( mctime );
+
+    evt.time       = time;
+    evt.component  = idx;
+    evt.name       = mtc->name;
+    evt.file_index = mtc->fileStamps[slot];
+    evt.evt_index  = mtc->evtStamps[slot];
+    evt.x          = mtc->xpos[evt.file_index][evt.evt_index];
+    evt.y          = mtc->ypos[evt.file_index][evt.evt_index];
+    evt.z          = mtc->zpos[evt.file_index][evt.evt_index];
+    evt.ds         = ds;
+    return true;
+  }
+  return false;
+}
+
+void MergerChainFactory::writeNewFile(std::string fname)
+{
+  // Assumes buildEvents has already filled each chain
+  openNewFile(fname);
+  MergedEvent evt;
+  while( nextMergedEvent(evt) )
+    fillNewFile(evt);
+  closeNewFile();
+  finishDataset();
+}
+
+void MergerChainFactory::openNewFile(std::string fname)
+{
   // Top file
   std::cout << LastFileName << std::endl;
   TFile* oldFile = new TFile(LastFileName.c_str());
@@ -133,71 +393,242 @@ void MergerChainFactory::buildNewFile(std::string fname)
   TTree* oldRunTree = (TTree*)oldFile->Get("runT");
 
   // Write to file
-  std::string outname = config->trainingDir + "/" + fname;
-  TFile* f = new TFile(outname.c_str(), "recreate");
+  this->outName = config->trainingDir + "/" + fname;
+  this->outFile = new TFile(outName.c_str(), "recreate");
   // Lets add a special header with info from this merge
   TTree* header = new TTree("header", "Merger information");
   double time = timenow; // seconds I believe
   header->Branch("livetime", &time);
+  double scale = rateScale;
+  if( rateScale >= 0 )
+    header->Branch("ratescale", &scale);
   header->Fill();
   // Run tree as well, we could clone from a random file?
   TTree* runT = oldRunTree->CloneTree(0);
   oldRunTree->GetEvent(0);
   runT->Fill();
+  if( coincidenceOnly )
+    writeSingles();
 
-  TTree* t = new TTree("T", "merged");
-  RAT::DS::Root* ds = new RAT::DS::Root();
-  t->Branch("ds", &ds);
-  std::string iname;
-  t->Branch("name", &iname);
+  this->outTree = new TTree("T", "merged");
+  this->outDS = nullptr;
+  outTree->Branch("ds", &outDS);
+  outTree->Branch("name", &outComponent);
+  this->outIndex = new TTree("index", "Time-ordered index of T");
+  outIndex->Branch("nanotime", &indexTime);
+  outIndex->Branch("entry", &indexEntry);
+  outIndex->Branch("component", &indexComponent);
+  outIndex->Branch("x", &indexX);
+  outIndex->Branch("y", &indexY);
+  outIndex->Branch("z", &indexZ);
+  countReuse();
+  // Reused events are written once, with their multiplicity as weight
+  if( reuseCount.size() > 0 )
+  {
+    outTree->Branch("weight", &outWeight);
+    this->outOccurrences = new TTree("occurrences", "Times of reused events");
+    outOccurrences->Branch("time", &occurrenceTime);
+    outOccurrences->Branch("entry", &occurrenceEntry);
+  }
   // Combine the chains into a single file
   if(verbose)
-    printf("Writing to file %s ...", outname.c_str());
-  for( auto iv : this->timeComponentMap )
+    printf("Writing to file %s ...", outName.c_str());
+}
+
+void MergerChainFactory::writeSingles()
+{
+  // Isolated events are summarized instead of written in full. The counts
+  // cover every sampled event so the livetime bookkeeping stays exact.
+  TTree* singleT = new TTree("singles", "Isolated events");
+  SingleRecord single;
+  float sx, sy, sz;
+  singleT->Branch("time", &single.time);
+  singleT->Branch("component", &single.component);
+  singleT->Branch("x", &sx);
+  singleT->Branch("y", &sy);
+  singleT->Branch("z", &sz);
+  for( auto& record : singles )
   {
-    double time = iv.first;
-    int idx = iv.second;
-    MergerTChain* mtc = chainList[idx];
-    iname = mtc->name;
-    ds = &( *(mtc->dsitr) );
-    ++mtc->dsitr;
-    if( ds->ExistMC() )
+    single = record;
+    sx = record.x;
+    sy = record.y;
+    sz = record.z;
+    singleT->Fill();
+  }
+  TTree* countT = new TTree("counts", "Events per component");
+  std::string cname;
+  Long64_t sampled, written, summarized;
+  countT->Branch("name", &cname);
+  countT->Branch("sampled", &sampled);
+  countT->Branch("written", &written);
+  countT->Branch("singles", &summarized);
+  std::vector<Long64_t> singleCount( chainList.size(), 0 );
+  for( auto& record : singles )
+    singleCount[ record.component ]++;
+  for( int cl=0; cl < chainList.size(); cl++ )
+  {
+    cname      = chainList[cl]->name;
+    sampled    = sampledCount[cl];
+    written    = writtenCount[cl];
+    summarized = singleCount[cl];
+    countT->Fill();
+  }
+}
+
+void MergerChainFactory::countReuse()
+{
+  // Multiplicity of every source event of the reuse components, walking
+  // the timeline from the current chain positions as nextMergedEvent will
+  reuseCount.clear();
+  reuseEntry.clear();
+  std::vector<int> slot;
+  for( auto mtc : chainList )
+    slot.push_back( std::distance( mtc->dsevents.begin(), mtc->dsitr ) );
+  for( auto tc : timeComponentMap )
+  {
+    MergerTChain* mtc = chainList[tc.second];
+    int s = slot[tc.second]++;
+    if( !mtc->reuse || !mtc->dsevents[s].ExistMC() ) continue;
+    reuseCount[ std::make_tuple( tc.second, mtc->fileStamps[s], mtc->evtStamps[s] ) ]++;
+  }
+}
+
+void MergerChainFactory::fillNewFile(MergedEvent& evt)
+{
+  this->outDS = evt.ds;
+  this->outComponent = evt.name;
+  this->outWeight = 1.0;
+  // Events arrive in time order, so the index is sorted as written
+  indexTime      = static_cast<ULong64_t>( llround( evt.time * 1e9 ) );
+  indexEntry     = outTree->GetEntries();
+  indexComponent = evt.component;
+  indexX         = evt.x;
+  indexY         = evt.y;
+  indexZ         = evt.z;
+  // As counted by countReuse, so the occurrences tree exists
+  if( chainList[evt.component]->reuse && evt.ds->ExistMC() )
+  {
+    // Only the first occurrence is written, every occurrence is listed
+    SourceKey key = std::make_tuple( evt.component, evt.file_index, evt.evt_index );
+    auto found = reuseEntry.find( key );
+    occurrenceTime = evt.time;
+    if( found != reuseEntry.end() )
     {
-      // Update the event. Set simulation time to Jan 1st 1970.
-      // Beware ... root sucks ...
-      // Also, uses 32 bit int, so TTimeStamp dies in 1938 -.-
-      TTimeStamp tt(1970, 1, 1, 0, 0, 0);
-      // Grab the MC time
-      time_t seconds = static_cast<time_t>(floor(time));
-      Int_t nanoseconds = static_cast<Int_t>( (time - seconds)*1e9 );
-      TTimeStamp mctime(seconds, nanoseconds);
-      //std::cout << "SET: " << mctime.GetSec() << " & " << nanoseconds << std::endl;
-      //mctime.Add(tt);
-      // 
-      RAT::DS::MC* mc = ds->GetMC();
-      mc->SetUTC( mctime );
-      // Print some things here, delete after
-      TVector3 v = ds->GetEV(0)->GetPathFit()->GetPosition();
-      //printf("True pos: %f, %f, %f\n", v.X(), v.Y(), v.Z());
-      //
-      t->Fill();
+      occurrenceEntry = found->second;
+      outOccurrences->Fill();
+      indexEntry = found->second;
+      outIndex->Fill();
+      return;
     }
+    occurrenceEntry = outTree->GetEntries();
+    reuseEntry[key] = occurrenceEntry;
+    outOccurrences->Fill();
+    this->outWeight = reuseCount[key];
   }
+  outTree->Fill();
+  outIndex->Fill();
+}
+
+void MergerChainFactory::closeNewFile()
+{
   if( verbose )
     printf(" done\n");
-  f->Write(0, TObject::kOverwrite);
-  f->Close();
+  outFile->Write(0, TObject::kOverwrite);
+  outFile->Close();
 
-  delete f;
+  delete outFile;
+  this->outFile = nullptr;
+  this->outTree = nullptr;
+  this->outOccurrences = nullptr;
+  this->outIndex = nullptr;
+  reuseCount.clear();
+  reuseEntry.clear();
+}
 
+void MergerChainFactory::finishDataset()
+{
   for( auto mtc : chainList )
   {
     mtc->reset();
   }
   timeComponentMap.clear();
+  resetCounts();
   this->timenow = 0;
 }
 
+RAT::DS::Run* MergerChainFactory::getRun()
+{
+  // Run information (PMTInfo) of the inputs, owned by the caller
+  TFile* f = TFile::Open(LastFileName.c_str());
+  TTree* runT = (TTree*)f->Get("runT");
+  RAT::DS::Run* run = new RAT::DS::Run();
+  runT->SetBranchAddress("run", &run);
+  runT->GetEvent(0);
+  f->Close();
+  delete f;
+  return run;
+}
+
+double MergerChainFactory::residentBytes()
+{
+  // Second field of statm, in pages
+  long pages = 0, resident = 0;
+  FILE* statm = fopen( "/proc/self/statm", "r" );
+  if( statm != nullptr )
+  {
+    if( fscanf( statm, "%ld %ld", &pages, &resident ) != 2 ) resident = 0;
+    fclose( statm );
+  }
+  return double(resident) * sysconf( _SC_PAGESIZE );
+}
+
+void MergerChainFactory::printEstimate(double samplingSeconds, double baseline)
+{
+  // Event sizes come from file sizes over the posdb counts, so selections
+  // are not applied and the volumes are upper bounds. Written sizes are
+  // those of a few events recompressed into a merged tree.
+  printf("%-24s %10s %10s %6s %10s %10s\n", "Component", "Sampled", "Kept",
+      "Files", "Read MB", "Write MB");
+  double readBytes = 0, writeBytes = 0;
+  double resident = 0, transient = 0;
+  double seconds = samplingSeconds;
+  for( int cl=0; cl < chainList.size(); cl++ )
+  {
+    MergerTChain* mtc = chainList[cl];
+    mtc->profile();
+    double events = mtc->timeStamps.size();
+    std::set<int> files( mtc->fileStamps.begin(), mtc->fileStamps.end() );
+    double read  = events * mtc->eventZipBytes;
+    double write = events * mtc->eventWriteBytes;
+    readBytes  += read;
+    writeBytes += write;
+    // Every chain keeps its events until the file is written, plus the
+    // holding copy of the chain being built
+    resident  += events * mtc->eventTotBytes;
+    transient  = std::max( transient, events * mtc->eventTotBytes );
+    seconds   += events * ( mtc->secondsPerEvent + mtc->secondsPerWrite );
+    printf("%-24s %10lld %10lld %6i %10.1f %10.1f\n", mtc->name.c_str(),
+        sampledCount[cl], Long64_t(events), int(files.size()), read/1e6, write/1e6);
+  }
+  printf("Livetime        : %.1f s\n", timenow);
+  printf("Bytes read      : %.1f MB\n", readBytes/1e6);
+  printf("Bytes written   : %.1f MB\n", writeBytes/1e6);
+  printf("Peak memory     : %.1f MB\n", (baseline + resident + transient)/1e6);
+  printf("Runtime         : %.0f s\n", seconds);
+}
+
+void MergerChainFactory::setCache(MergerEventCache* cache)
+{
+  for( auto cl : chainList )
+    cl->setCache( cache );
+}
+
+void MergerChainFactory::setPrefetcher(MergerPrefetcher* prefetcher)
+{
+  for( auto cl : chainList )
+    cl->prefetcher = prefetcher;
+}
+
 std::vector<std::string> MergerChainFactory::listDir(std::string directory)
 {
   std::vector<std::string> files;
@@ -211,9 +642,14 @@ std::vector<std::string> MergerChainFactory::listDir(std::string directory)
 // Merger TChain
 MergerTChain::MergerTChain( std::string dstree, std::string dsbranch, 
     std::string name, std::vector<std::string> directory, double rate, 
-    bool is_single, TRandom3* rndm ) :
+    bool is_single, TRandom3* rndm, std::string selection,
+    std::map<std::string, std::string> aliases ) :
   dstree(dstree), dsbranch(dsbranch), name(name), directory(directory), 
-  rate(rate), is_single(is_single), rndm(rndm)
+  rate(rate), is_single(is_single), rndm(rndm), selection(selection),
+  aliases(aliases), rejected(0), bytesRead(0), bytesNeeded(0), profiled(false),
+  eventZipBytes(0), eventTotBytes(0), secondsPerEvent(0), eventWriteBytes(0),
+  secondsPerWrite(0), scan(true),
+  reuse(false), prefetcher(nullptr)
 {
   ds = new RAT::DS::Root();
   setupHeader();
@@ -280,22 +716,99 @@ void MergerTChain::setupDB()
 }
 
 void MergerTChain::getRandomEvent()
+{
+  double ufile = rndm->Rndm();
+  double uevt  = rndm->Rndm();
+  pickEvent( ufile, uevt );
+}
+
+void MergerTChain::locateEvent(double ufile, double uevt, int& findex, int& evindex)
 {
   // Choose a random file
-  file_index = int( rndm->Rndm() * entries );
+  findex  = int( ufile * entries );
   // Choose a random evt from the file
-  evt_index  = int( rndm->Rndm() * xpos[ file_index ].size() );
+  evindex = int( uevt * xpos[ findex ].size() );
+}
+
+void MergerTChain::prefetchEvent(double ufile, double uevt)
+{
+  if( prefetcher == nullptr ) return;
+  int findex, evindex;
+  locateEvent( ufile, uevt, findex, evindex );
+  prefetchEntry( findex, evindex );
+}
+
+void MergerTChain::prefetchEntry(int findex, int evindex)
+{
+  if( prefetcher == nullptr ) return;
+  prefetcher->request( directory[findex], evindex );
+}
+
+void MergerTChain::pickEvent(double ufile, double uevt)
+{
+  locateEvent( ufile, uevt, file_index, evt_index );
   x = xpos[file_index][evt_index];
   y = ypos[file_index][evt_index];
   z = zpos[file_index][evt_index];
 }
 
+void MergerTChain::profile()
+{
+  if( profiled || directory.size() == 0 ) return;
+  Long64_t bytes  = 0;
+  Long64_t events = 0;
+  for( int i=0; i < directory.size(); i++ )
+  {
+    bytes  += boost::filesystem::file_size( directory[i] );
+    events += xpos[i].size();
+  }
+  this->eventZipBytes = events > 0 ? double(bytes) / events : 0;
+  // Compression factor and read speed from the first few events of a file
+  TFile* f = TFile::Open( directory[0].c_str() );
+  TTree* t = (TTree*)f->Get( dstree.c_str() );
+  double ratio = t->GetZipBytes() > 0 ? double(t->GetTotBytes()) / t->GetZipBytes() : 1;
+  this->eventTotBytes = eventZipBytes * ratio;
+  RAT::DS::Root* rds = new RAT::DS::Root();
+  t->SetBranchAddress( dsbranch.c_str(), &rds );
+  int n = std::min( Long64_t(10), t->GetEntries() );
+  auto start = std::chrono::steady_clock::now();
+  for( int i=0; i < n; i++ )
+    t->GetEntry(i);
+  double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  this->secondsPerEvent = n > 0 ? elapsed / n : 0;
+  // The same events written as the merger writes them, in memory
+  TMemFile* mem = new TMemFile( "profile.root", "recreate" );
+  TTree* out = new TTree( "T", "merged" );
+  out->Branch( "ds", &rds );
+  start = std::chrono::steady_clock::now();
+  for( int i=0; i < n; i++ )
+  {
+    t->GetEntry(i);
+    out->Fill();
+  }
+  out->FlushBaskets();
+  elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  this->secondsPerWrite = n > 0 ? std::max( 0.0, elapsed / n - secondsPerEvent ) : 0;
+  this->eventWriteBytes = n > 0 ? double(out->GetZipBytes()) / n : eventZipBytes;
+  delete mem;
+  f->Close();
+  delete f;
+  delete rds;
+  this->profiled = true;
+}
+
 void MergerTChain::addNewFile( std::string fname )
 {
-  MergerTFile* mtf = new MergerTFile( dstree, dsbranch, fname, rndm );
+  MergerTFile* mtf = new MergerTFile( dstree, dsbranch, fname, rndm, selection, aliases );
   this->dataVec.push_back(mtf);
 }
 
+void MergerTChain::setCache( MergerEventCache* cache )
+{
+  for( auto mtf : this->dataVec )
+    mtf->cache = cache;
+}
+
 MergerTChain::~MergerTChain()
 {
   // Lots to do here
@@ -325,6 +838,10 @@ void MergerTChain::eventBuilder(bool verbose=false)
   }
 
   std::vector<RAT::DS::Root> dsholder;
+  // Where each file's events start in dsholder
+  std::vector<int> foffset(entries, 0);
+  for(int iv=1; iv < entries; iv++)
+    foffset[iv] = foffset[iv-1] + fcount[iv-1].size();
 
   for(int iv=0; iv < entries; iv++)
   {
@@ -335,12 +852,23 @@ void MergerTChain::eventBuilder(bool verbose=false)
       dataVec[iv]->open();
       std::vector<RAT::DS::Root> a = dataVec[iv]->getSubset( fcount[iv] );
       dsholder.insert( dsholder.end(), a.begin(), a.end() );
+      rejected += dataVec[iv]->rejected;
+      bytesRead += dataVec[iv]->bytesRead;
+      bytesNeeded += dataVec[iv]->bytesNeeded;
+      dataVec[iv]->rejected = 0;
+      dataVec[iv]->bytesRead = 0;
+      dataVec[iv]->bytesNeeded = 0;
       dataVec[iv]->close();
-      delete dataVec[iv]; // Does this help?
     }
   }
   if( verbose )
     printf("\n");
+  if( verbose && selection != "" )
+    printf("\t<eventbuilder>: %s rejected %i of %i\n", name.c_str(), rejected,
+        int(fileStamps.size()));
+  if( verbose && bytesNeeded > 0 )
+    printf("\t<eventbuilder>: %s read %.1f MB for %.1f MB of events (%.2fx)\n",
+        name.c_str(), bytesRead/1e6, bytesNeeded/1e6, double(bytesRead)/bytesNeeded);
   // Shuffle vector<ds>
   //this->shuffleDS();
   dsevents.resize( fileStamps.size() );
@@ -349,10 +877,10 @@ void MergerTChain::eventBuilder(bool verbose=false)
     int findex  = fileStamps[i];
     int evindex = evtStamps[i];
     // Where in dsholder do I live?
-    auto v = fcount[findex];
-    int index = std::distance( v.begin(), std::find(v.begin(), v.end(), evindex) );
+    const std::vector<int>& v = fcount[findex];
+    int index = std::distance( v.begin(), std::lower_bound(v.begin(), v.end(), evindex) );
     // printf("evtstamp: %i at %i\n", evindex, index);
-    dsevents[i] = dsholder[index];
+    dsevents[i] = dsholder[foffset[findex] + index];
   }
   // fcount has the new [file_index][evt] order
   // Initialize / reset the event iterator
@@ -386,8 +914,11 @@ void MergerTChain::reset()
 
 // Control individual TFiles (lowest level)
 
-MergerTFile::MergerTFile( std::string dstree, std::string dsbranch, std::string fname, TRandom3* rndm ) :
-  dstree(dstree), dsbranch(dsbranch), fname(fname), rndm(rndm)
+MergerTFile::MergerTFile( std::string dstree, std::string dsbranch, std::string fname, TRandom3* rndm,
+    std::string selection, std::map<std::string, std::string> aliases ) :
+  dstree(dstree), dsbranch(dsbranch), fname(fname), rndm(rndm), selection(selection),
+  aliases(aliases), cut(nullptr), cache(nullptr), rejected(0),
+  bytesRead(0), bytesNeeded(0)
 {
 }
 
@@ -403,10 +934,25 @@ void MergerTFile::open()
   ds = new RAT::DS::Root();
   ttree->SetBranchAddress( "ds", &ds );
   entries = ttree->GetEntries();
+  if( selection != "" )
+  {
+    // The formula only reads the sub-branches it references, so the cut
+    // is decided before the full RAT::DS::Root is deserialized
+    for( auto alias : aliases )
+      ttree->SetAlias( alias.first.c_str(), alias.second.c_str() );
+    cut = new TTreeFormula( "selection", selection.c_str(), ttree );
+    if( cut->GetNdim() == 0 )
+    {
+      std::cerr << "Invalid selection \"" << selection << "\" for " << fname << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
 }
 
 void MergerTFile::close()
 {
+  delete cut;
+  cut = nullptr;
   tfile->Close();
   delete tfile;
   delete ds;
@@ -423,44 +969,104 @@ std::vector<RAT::DS::Root> MergerTFile::getSubset(std::vector<int> events)
   //  entry.push_back( int( rndm->Rndm()*entries ) );
   //}
   std::sort(events.begin(), events.end());
-  for(auto iv : events)
+  Long64_t bytes0 = tfile->GetBytesRead();
+  // The cut is decided first, while the cache only holds the branches the
+  // formula reads, so rejected events cost those baskets and nothing more
+  std::vector<char> pass( events.size(), 1 );
+  if( cut != nullptr )
   {
-    ttree->GetEvent(iv);
-    if( this->checkEvent() )
+    planClusters( events, false );
+    for( size_t i=0; i < events.size(); i++ )
+      pass[i] = this->checkEvent( events[i] );
+  }
+  std::vector<int> wanted;
+  for( size_t i=0; i < events.size(); i++ )
+    if( pass[i] ) wanted.push_back( events[i] );
+  // Read only the clusters holding events that passed, each in one go
+  std::vector< std::pair<Long64_t, Long64_t> > clusters = planClusters( wanted, true );
+  auto cluster = clusters.begin();
+  if( cluster != clusters.end() )
+    ttree->SetCacheEntryRange( cluster->first, cluster->second );
+  for( size_t i=0; i < events.size(); i++ )
+  {
+    int iv = events[i];
+    if( !pass[i] )
+    {
+      // Rejected events keep their slot but carry no MC, so they are
+      // dropped when the merged file is written
+      ratpile.push_back(RAT::DS::Root());
+      rejected++;
+      continue;
+    }
+    if( cluster != clusters.end() && iv >= cluster->second )
     {
-      ratpile.push_back(*ds);
+      while( cluster != clusters.end() && iv >= cluster->second ) ++cluster;
+      if( cluster != clusters.end() )
+        ttree->SetCacheEntryRange( cluster->first, cluster->second );
     }
-    else
+    if( cache == nullptr || !cache->get( fname, iv, ds ) )
     {
-      ratpile.push_back(RAT::DS::Root());
+      ttree->GetEvent(iv);
+      if( cache != nullptr )
+        cache->put( fname, iv, ds );
     }
-    //ratpile.push_back(*ds);
+    ratpile.push_back(*ds);
   }
+  bytesRead += tfile->GetBytesRead() - bytes0;
   // Did it work??
   return ratpile;
 }
 
-bool MergerTFile::checkEvent()
+std::vector< std::pair<Long64_t, Long64_t> > MergerTFile::planClusters(std::vector<int>& events, bool full)
 {
-  // Not using this yet
-  return true;
-  // Right now this is just an example, will change based on Stephane's structure.
-  int min_nhit = 60;
-  // High level cuts on event ev branch
-  // 1. EVCount < 1
-  if( ds->GetEVCount() < 1 )
-    return false;
-  // 2. nhits < min_nhit
-  int high_count = 0;
-  for( int iev=0; iev < ds->GetEVCount(); iev++ )
-  {
-    RAT::DS::EV* ev = ds->GetEV(iev);
-    int count = ev->GetPMTCount();
-    if( count > high_count )
-      high_count = count;
-  }
-  if( high_count < min_nhit )
-    return false;
+  // Clusters [start, end) holding at least one of the sorted events. The
+  // TTreeCache is sized to the largest of them at the average event size
+  // and restricted to the cluster being read, so baskets of unrequested
+  // clusters are never read.
+  std::vector< std::pair<Long64_t, Long64_t> > clusters;
+  Long64_t nentries = ttree->GetEntries();
+  if( nentries < 1 || events.size() < 1 ) return clusters;
+  TTree::TClusterIterator it = ttree->GetClusterIterator( events.front() );
+  Long64_t start;
+  auto ev = events.begin();
+  while( ev != events.end() && (start = it.Next()) < nentries )
+  {
+    Long64_t end = it.GetNextEntry();
+    if( *ev < end )
+      clusters.push_back( std::make_pair( start, end ) );
+    while( ev != events.end() && *ev < end ) ++ev;
+  }
+  double eventBytes = double( ttree->GetZipBytes() ) / nentries;
+  Long64_t clusterEntries = 0;
+  for( auto& c : clusters )
+    clusterEntries = std::max( clusterEntries, c.second - c.first );
+  ttree->SetCacheSize( Long64_t( 1.25 * eventBytes * clusterEntries ) + 1024*1024 );
+  if( !full )
+  {
+    // Learning again from scratch, the cache picks up only the branches
+    // the cut formula reads
+    TTreeCache* learning = ttree->GetReadCache( tfile );
+    if( learning != nullptr )
+      learning->StartLearningPhase();
+    return clusters;
+  }
+  ttree->AddBranchToCache( "*", true );
+  ttree->StopCacheLearningPhase();
+  bytesNeeded += Long64_t( eventBytes * events.size() );
+  return clusters;
+}
 
-  return true;
+bool MergerTFile::checkEvent(int entry)
+{
+  if( cut == nullptr )
+    return true;
+  ttree->LoadTree(entry);
+  // Keep the event if any EV instance passes
+  int ndata = cut->GetNdata();
+  for( int i=0; i < ndata; i++ )
+  {
+    if( cut->EvalInstance(i) != 0 )
+      return true;
+  }
+  return false;
 }
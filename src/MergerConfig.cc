@@ -44,6 +44,23 @@ void MergerConfig::boostRead()
   this->deltat      = header.get<double>( "deltat" );
   this->deltar      = header.get<double>( "deltar" );
 
+  // Optional rate scan, a list of scale factors applied to the scanned rates
+  if( header.count( "rate_scan" ) )
+  {
+    for( const auto& scale : header.get_child( "rate_scan" ) )
+      this->rateScan.push_back( scale.second.get_value<double>() );
+  }
+
+  // Selection aliases, each evaluated per EV on lightweight sub-branches
+  this->aliases["evcount"]  = "Length$(ev.id)";
+  this->aliases["nhit"]     = "ev.pmt@.size()";
+  this->aliases["goodness"] = "ev.pathfit.goodness";
+  if( header.count( "aliases" ) )
+  {
+    for( const auto& alias : header.get_child( "aliases" ) )
+      this->aliases[alias.first] = alias.second.get_value<std::string>();
+  }
+
   // Grab each component and store its name, directory, and rate
   for( const auto& parent : iroot.get_child(component_list) )
   {
@@ -53,7 +70,10 @@ void MergerConfig::boostRead()
           component.get<std::string>("name"),
           component.get<std::string>("directory"),
           component.get<double>("rate"),
-          component.get<std::string>("class")
+          component.get<std::string>("class"),
+          component.get<std::string>("selection", ""),
+          component.get<bool>("scan", true),
+          component.get<bool>("reuse", false)
           ));
   }
 }
@@ -66,8 +86,18 @@ void MergerConfig::print()
   std::cout << "\t" << "Sample Directory   :" << this->sampleDir << std::endl;
   std::cout << "\t" << "Read Tree          :" << this->dstree << std::endl;
   std::cout << "\t" << "Read Branch        :" << this->dsbranch << std::endl;
+  if( rateScan.size() > 0 )
+  {
+    std::cout << "\t" << "Rate scan          :";
+    for( auto scale : rateScan ) std::cout << " " << scale;
+    std::cout << std::endl;
+  }
   for( auto mcc : componentList )
   {
     std::cout << "\t" << "> " << mcc->name << " @ " << mcc->rate << " :" << mcc->dir << std::endl;
+    if( mcc->selection != "" )
+      std::cout << "\t" << "  selection: " << mcc->selection << std::endl;
+    if( mcc->reuse )
+      std::cout << "\t" << "  reuse: distinct events written once" << std::endl;
   }
 }
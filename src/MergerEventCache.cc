@@ -0,0 +1,337 @@
+#include <MergerEventCache.hh>
+#include <TBufferFile.h>
+#include <iostream>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+  // Changes with the layout, so older segments are not attached
+  const uint64_t cacheMagic = 0x57626c5343613032ULL;
+  const uint64_t slotEmpty  = 0;
+  const uint64_t slotFull   = 1;
+  const uint64_t slotFree   = 2; // tombstone, keeps probe chains intact
+  const uint64_t align      = 8;
+  // Give up on the cache rather than stall behind a stuck peer
+  const int lockTimeout     = 5;
+}
+
+MergerEventCache::MergerEventCache( std::string name, uint64_t budget ) :
+  name(name), budget(budget), hits(0), misses(0), stored(0), disabled(false),
+  fd(-1), mapsize(0), header(nullptr), slots(nullptr), ring(nullptr)
+{
+  if( this->name[0] != '/' )
+    this->name = "/" + this->name;
+  // Roughly one slot per 4 kB of budget, at least 1024
+  uint64_t nslots = 1024;
+  while( nslots * 4096 < budget ) nslots *= 2;
+  uint64_t capacity = (budget / align) * align;
+  uint64_t hsize = ((sizeof(Header) + align - 1) / align) * align;
+  mapsize = hsize + nslots * sizeof(Slot) + capacity;
+
+  bool creator = true;
+  fd = shm_open( this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660 );
+  if( fd < 0 && errno == EEXIST )
+  {
+    creator = false;
+    fd = shm_open( this->name.c_str(), O_RDWR, 0660 );
+  }
+  if( fd < 0 )
+  {
+    std::cerr << "Event cache: cannot open " << this->name << ": " << strerror(errno) << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if( creator )
+  {
+    if( ftruncate( fd, mapsize ) != 0 )
+    {
+      std::cerr << "Event cache: cannot size " << this->name << ": " << strerror(errno) << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  else
+  {
+    // Attach with the geometry the creator chose, waiting for it to finish
+    struct stat st;
+    for( int tries=0; tries < 1000; tries++ )
+    {
+      fstat( fd, &st );
+      if( st.st_size > 0 ) break;
+      usleep(1000);
+    }
+    mapsize = st.st_size;
+  }
+  void* base = mmap( nullptr, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  if( base == MAP_FAILED )
+  {
+    std::cerr << "Event cache: cannot map " << this->name << ": " << strerror(errno) << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  header = static_cast<Header*>(base);
+  if( creator )
+  {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init( &attr );
+    pthread_mutexattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+    pthread_mutexattr_setrobust( &attr, PTHREAD_MUTEX_ROBUST );
+    pthread_mutex_init( &header->lock, &attr );
+    pthread_mutexattr_destroy( &attr );
+    header->capacity   = capacity;
+    header->nslots     = nslots;
+    header->head       = 0;
+    header->tail       = 0;
+    header->tombstones = 0;
+    // Publish only once everything else is in place
+    __sync_synchronize();
+    header->magic    = cacheMagic;
+  }
+  else
+  {
+    for( int tries=0; tries < 1000 && header->magic != cacheMagic; tries++ )
+      usleep(1000);
+    if( header->magic != cacheMagic )
+    {
+      std::cerr << "Event cache: " << this->name << " was never initialized" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    this->budget = header->capacity;
+  }
+  slots = reinterpret_cast<Slot*>( reinterpret_cast<char*>(base) + hsize );
+  ring  = reinterpret_cast<char*>( slots + header->nslots );
+}
+
+MergerEventCache::~MergerEventCache()
+{
+  if( header != nullptr )
+    munmap( header, mapsize );
+  if( fd >= 0 )
+    close( fd );
+}
+
+uint64_t MergerEventCache::makeKey( const std::string& fname, int entry )
+{
+  // FNV-1a over the file name and entry number
+  uint64_t key = 1469598103934665603ULL;
+  for( char c : fname )
+  {
+    key ^= static_cast<unsigned char>(c);
+    key *= 1099511628211ULL;
+  }
+  for( int b=0; b < 4; b++ )
+  {
+    key ^= (entry >> (8*b)) & 0xff;
+    key *= 1099511628211ULL;
+  }
+  return key == 0 ? 1 : key;
+}
+
+MergerEventCache::Slot* MergerEventCache::findSlot( uint64_t key )
+{
+  uint64_t mask = header->nslots - 1;
+  for( uint64_t i=0; i < header->nslots; i++ )
+  {
+    Slot* slot = &slots[ (key + i) & mask ];
+    if( slot->state == slotEmpty ) return nullptr;
+    if( slot->state == slotFull && slot->key == key ) return slot;
+  }
+  return nullptr;
+}
+
+void MergerEventCache::insertSlot( uint64_t key, uint64_t position )
+{
+  uint64_t mask = header->nslots - 1;
+  for( uint64_t i=0; i < header->nslots; i++ )
+  {
+    Slot* slot = &slots[ (key + i) & mask ];
+    if( slot->state != slotFull )
+    {
+      if( slot->state == slotFree ) header->tombstones--;
+      slot->key      = key;
+      slot->position = position;
+      slot->state    = slotFull;
+      return;
+    }
+  }
+}
+
+void MergerEventCache::rebuildSlots()
+{
+  memset( slots, 0, header->nslots * sizeof(Slot) );
+  header->tombstones = 0;
+  uint64_t position = header->tail;
+  while( position < header->head )
+  {
+    uint64_t offset = position % header->capacity;
+    uint64_t left   = header->capacity - offset;
+    if( left < sizeof(Record) )
+    {
+      position += left;
+      continue;
+    }
+    Record* record = reinterpret_cast<Record*>( ring + offset );
+    if( record->key != 0 )
+      insertSlot( record->key, position );
+    position += record->size;
+  }
+}
+
+void MergerEventCache::reset()
+{
+  memset( slots, 0, header->nslots * sizeof(Slot) );
+  header->head       = 0;
+  header->tail       = 0;
+  header->tombstones = 0;
+}
+
+bool MergerEventCache::lock()
+{
+  if( disabled ) return false;
+  struct timespec deadline;
+  clock_gettime( CLOCK_REALTIME, &deadline );
+  deadline.tv_sec += lockTimeout;
+  int status = pthread_mutex_timedlock( &header->lock, &deadline );
+  if( status == EOWNERDEAD )
+  {
+    // The owner died inside get or put, and may have left the table half
+    // updated; start over rather than trust any of it
+    std::cerr << "Event cache: a process died holding " << name << ", emptying it" << std::endl;
+    reset();
+    pthread_mutex_consistent( &header->lock );
+    return true;
+  }
+  if( status != 0 )
+  {
+    std::cerr << "Event cache: " << name << " stayed locked for " << lockTimeout
+              << " s, reading events without it" << std::endl;
+    disabled = true;
+    return false;
+  }
+  return true;
+}
+
+void MergerEventCache::unlock()
+{
+  pthread_mutex_unlock( &header->lock );
+}
+
+bool MergerEventCache::get( const std::string& fname, int entry, RAT::DS::Root* ds )
+{
+  uint64_t key = makeKey( fname, entry );
+  if( !lock() )
+  {
+    misses++;
+    return false;
+  }
+  Slot* slot = findSlot( key );
+  Record* record = nullptr;
+  const char* recname = nullptr;
+  if( slot != nullptr )
+  {
+    record  = reinterpret_cast<Record*>( ring + slot->position % header->capacity );
+    recname = reinterpret_cast<const char*>(record + 1);
+  }
+  // The key is only a hash, the record holds the real file and entry
+  if( record == nullptr || record->entry != entry || record->namelen != fname.size() ||
+      fname.compare( 0, fname.size(), recname, record->namelen ) != 0 )
+  {
+    unlock();
+    misses++;
+    return false;
+  }
+  // Stream straight from the ring; the lock keeps the record from being
+  // evicted meanwhile, and the buffer does not own the memory
+  TBufferFile buffer( TBuffer::kRead, record->payload,
+                      const_cast<char*>(recname) + record->namelen, kFALSE );
+  ds->Streamer( buffer );
+  unlock();
+  hits++;
+  return true;
+}
+
+void MergerEventCache::evictOldest()
+{
+  uint64_t offset = header->tail % header->capacity;
+  uint64_t left   = header->capacity - offset;
+  if( left < sizeof(Record) )
+  {
+    header->tail += left;
+    return;
+  }
+  Record* record = reinterpret_cast<Record*>( ring + offset );
+  if( record->key != 0 )
+  {
+    Slot* slot = findSlot( record->key );
+    if( slot != nullptr && slot->position == header->tail )
+    {
+      slot->state = slotFree;
+      header->tombstones++;
+    }
+  }
+  header->tail += record->size;
+}
+
+void MergerEventCache::put( const std::string& fname, int entry, RAT::DS::Root* ds )
+{
+  if( disabled ) return;
+  // Serialize outside of the lock
+  TBufferFile buffer( TBuffer::kWrite );
+  ds->Streamer( buffer );
+  uint64_t payload = buffer.Length();
+  uint64_t size = ( (sizeof(Record) + fname.size() + payload + align - 1) / align ) * align;
+  // Events this large would flush most of the cache
+  if( size > header->capacity / 4 ) return;
+
+  uint64_t key = makeKey( fname, entry );
+  if( !lock() ) return;
+  // Misses probe past every tombstone, so clear them out once they make
+  // up a quarter of the table
+  if( header->tombstones > header->nslots / 4 )
+    rebuildSlots();
+  if( findSlot( key ) != nullptr )
+  {
+    unlock();
+    return;
+  }
+  // Records never wrap, pad to the start of the ring instead
+  uint64_t offset = header->head % header->capacity;
+  uint64_t left   = header->capacity - offset;
+  if( left < size )
+  {
+    while( header->head + left - header->tail > header->capacity )
+      evictOldest();
+    if( left >= sizeof(Record) )
+    {
+      Record* pad = reinterpret_cast<Record*>( ring + offset );
+      pad->key  = 0;
+      pad->size = left;
+    }
+    header->head += left;
+  }
+  while( header->head + size - header->tail > header->capacity )
+    evictOldest();
+
+  Record* record = reinterpret_cast<Record*>( ring + header->head % header->capacity );
+  record->key     = key;
+  record->size    = size;
+  record->entry   = entry;
+  record->namelen = fname.size();
+  record->payload = payload;
+  char* data = reinterpret_cast<char*>(record + 1);
+  memcpy( data, fname.data(), fname.size() );
+  memcpy( data + fname.size(), buffer.Buffer(), payload );
+  insertSlot( key, header->head );
+  stored++;
+  header->head += size;
+  unlock();
+}
+
+void MergerEventCache::print()
+{
+  printf("Event cache %s: %ld hits, %ld misses, %ld stored (%.1f MB budget)\n",
+      name.c_str(), hits, misses, stored, budget / 1e6);
+}
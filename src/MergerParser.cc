@@ -3,6 +3,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <iostream>
+#include <sstream>
 #include <stdlib.h>
 
 MergerParser::MergerParser( std::vector<std::string> _args) :
@@ -19,6 +20,7 @@ MergerParser::MergerParser( std::vector<std::string> _args) :
   // Json config file
   this->config = args[0];
   std::string iv = "";
+  bool userSubdir = false;
   for( auto v : args )
   {
     // Number of datasets to produce
@@ -36,16 +38,57 @@ MergerParser::MergerParser( std::vector<std::string> _args) :
     {
       this->time = stod(v);
     }
-    // Subdirectory
+    // Subdirectory, repeat or comma separate for a multi-target sweep
     if( iv == "-d" || iv == "--subdir" )
     {
-      this->subdir = v;
+      if( !userSubdir ) this->subdirs.clear();
+      userSubdir = true;
+      std::stringstream ss(v);
+      std::string target;
+      while( std::getline( ss, target, ',' ) )
+      {
+        if( target != "" ) this->subdirs.push_back( target );
+      }
+    }
+    // Shared-memory event cache name and size in MB
+    if( iv == "--shm-cache" )
+    {
+      this->shmCache = v;
+    }
+    if( iv == "--shm-size" )
+    {
+      this->shmSize = stod(v);
+    }
+    // Threads reading ahead while the timeline is sampled
+    if( iv == "--prefetch" )
+    {
+      this->prefetch = stoi(v);
     }
     // Verbose
     if( v == "-v" || v == "--verbose" )
     {
       this->verbose = true;
     }
+    // Write the flat ntuple directly instead of the merged RAT file
+    if( v == "--ntuple" )
+    {
+      this->ntuple = true;
+    }
+    // With --ntuple, also keep the full merged RAT file
+    if( v == "--tee" )
+    {
+      this->tee = true;
+    }
+    // Full events only for coincidence candidates, singles summarized
+    if( v == "--coincidence-only" )
+    {
+      this->coincidenceOnly = true;
+    }
+    // Sample the timeline and estimate resources, nothing is written
+    if( v == "--dry-run" )
+    {
+      this->dryRun = true;
+    }
     // REALLY verbose
     if( v == "-vv" )
     {
@@ -53,6 +96,8 @@ MergerParser::MergerParser( std::vector<std::string> _args) :
     }
     iv = v;
   }
+  if( this->subdirs.size() == 0 ) this->subdirs.push_back( "" );
+  this->subdir = this->subdirs[0];
   // Verbose print
   if( this->verbose )
   {
@@ -62,7 +107,11 @@ MergerParser::MergerParser( std::vector<std::string> _args) :
     std::cout << "| Num datasets   : " << this->num << std::endl;
     std::cout << "| Dataset start  : " << this->start << std::endl;
     std::cout << "| Dataset length : " << this->time << std::endl;
-    std::cout << "| Subdirectory   : " << this->subdir << std::endl;
+    for( auto target : this->subdirs )
+      std::cout << "| Subdirectory   : " << target << std::endl;
+    if( this->shmCache != "" )
+      std::cout << "| Event cache    : " << this->shmCache << " (" << this->shmSize << " MB)" << std::endl;
+    std::cout << "| Ntuple output  : " << this->ntuple << (this->tee ? " (tee)" : "") << std::endl;
     std::cout << "| ---------------------------------------------" << std::endl;
   }
 }
@@ -76,7 +125,16 @@ void MergerParser::setDefaultParams()
   this->num     = 1;
   this->time    = 3600;
   this->verbose = false;
+  this->superverbose = false;
+  this->ntuple  = false;
+  this->tee     = false;
+  this->coincidenceOnly = false;
+  this->dryRun  = false;
   this->subdir  = "wm_20pct_geo/wbls_1pct";
+  this->subdirs = { this->subdir };
+  this->shmCache = "";
+  this->shmSize = 1024;
+  this->prefetch = 0;
 }
 
 void MergerParser::help()
@@ -85,7 +143,14 @@ void MergerParser::help()
   std::cout << "    -h,--help    : Print help dialog" << std::endl;
   std::cout << "    -n,--num     : Specify number of datasets" << std::endl;
   std::cout << "    -t,--time    : Length of dataset (seconds)" << std::endl;
-  std::cout << "    -d,--subdir  : Subdirectory (geo/target)" << std::endl;
+  std::cout << "    -d,--subdir  : Subdirectory (geo/target), several for a sweep" << std::endl;
+  std::cout << "    --ntuple     : Write the flat ntuple in-process" << std::endl;
+  std::cout << "    --tee        : With --ntuple, also write the merged RAT file" << std::endl;
+  std::cout << "    --coincidence-only : Summarize isolated events" << std::endl;
+  std::cout << "    --shm-cache  : Name of a node-local shared event cache" << std::endl;
+  std::cout << "    --shm-size   : Size of the shared event cache (MB)" << std::endl;
+  std::cout << "    --prefetch N : Prefetch events with N threads while sampling" << std::endl;
+  std::cout << "    --dry-run    : Estimate counts, I/O, memory and runtime only" << std::endl;
   std::cout << "    -v,--verbose : Verbose" << std::endl;
   exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,163 @@
+#include <MergerPrefetcher.hh>
+#include <TROOT.h>
+#include <TFile.h>
+#include <TObjArray.h>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+MergerPrefetcher::MergerPrefetcher( int nthreads, std::string dstree ) :
+  dstree(dstree), requested(0), baskets(0), bytes(0), busy(0), stop(false)
+{
+  // Workers open the source files themselves
+  ROOT::EnableThreadSafety();
+  for( int i=0; i < nthreads; i++ )
+    workers.push_back( std::thread( &MergerPrefetcher::work, this ) );
+}
+
+MergerPrefetcher::~MergerPrefetcher()
+{
+  {
+    std::lock_guard<std::mutex> guard( queueLock );
+    stop = true;
+    queue.clear();
+  }
+  wake.notify_all();
+  for( auto& t : workers ) t.join();
+  for( auto p : layouts ) delete p.second;
+  layouts.clear();
+}
+
+void MergerPrefetcher::request( const std::string& fname, int entry )
+{
+  {
+    std::lock_guard<std::mutex> guard( queueLock );
+    queue.push_back( std::make_pair( fname, entry ) );
+  }
+  requested++;
+  wake.notify_one();
+}
+
+void MergerPrefetcher::drain()
+{
+  std::unique_lock<std::mutex> guard( queueLock );
+  idle.wait( guard, [this]{ return queue.empty() && busy == 0; } );
+}
+
+void MergerPrefetcher::work()
+{
+  while( true )
+  {
+    std::pair<std::string, int> job;
+    {
+      std::unique_lock<std::mutex> guard( queueLock );
+      wake.wait( guard, [this]{ return stop || !queue.empty(); } );
+      if( stop ) return;
+      job = queue.front();
+      queue.pop_front();
+      busy++;
+    }
+    FileLayout* fl = layout( job.first );
+    if( fl != nullptr )
+      prefetch( job.first, fl, job.second );
+    {
+      std::lock_guard<std::mutex> guard( queueLock );
+      busy--;
+    }
+    idle.notify_all();
+  }
+}
+
+MergerPrefetcher::FileLayout* MergerPrefetcher::layout( const std::string& fname )
+{
+  FileLayout* fl;
+  {
+    std::lock_guard<std::mutex> guard( layoutLock );
+    auto found = layouts.find( fname );
+    if( found == layouts.end() )
+    {
+      fl = new FileLayout();
+      fl->ready = false;
+      layouts[fname] = fl;
+    }
+    else
+      fl = found->second;
+  }
+  // The first worker to reach a file reads its basket tables, which also
+  // warms the file header and keys for eventBuilder
+  std::lock_guard<std::mutex> guard( fl->lock );
+  if( !fl->ready )
+  {
+    TFile* f = TFile::Open( fname.c_str(), "read" );
+    if( f != nullptr && !f->IsZombie() )
+    {
+      TTree* tree = (TTree*)f->Get( dstree.c_str() );
+      if( tree != nullptr )
+      {
+        TObjArray* branches = tree->GetListOfBranches();
+        for( int i=0; i < branches->GetEntriesFast(); i++ )
+          addBaskets( (TBranch*)branches->At(i), tree->GetEntries(), fl->ranges );
+      }
+      f->Close();
+    }
+    delete f;
+    std::sort( fl->ranges.begin(), fl->ranges.end(),
+        []( const BasketRange& a, const BasketRange& b ){ return a.first < b.first; } );
+    fl->ready = true;
+  }
+  return fl;
+}
+
+void MergerPrefetcher::addBaskets( TBranch* branch, Long64_t entries, std::vector<BasketRange>& ranges )
+{
+  // The ds branch is split, so the baskets live on the leaf branches
+  int nbaskets = branch->GetWriteBasket();
+  Long64_t* first = branch->GetBasketEntry();
+  Int_t* size = branch->GetBasketBytes();
+  for( int b=0; b < nbaskets; b++ )
+  {
+    BasketRange range;
+    range.first = first[b];
+    range.last  = (b+1 < nbaskets) ? first[b+1] - 1 : entries - 1;
+    range.seek  = branch->GetBasketSeek(b);
+    range.size  = size[b];
+    if( range.seek > 0 && range.size > 0 )
+      ranges.push_back( range );
+  }
+  TObjArray* subbranches = branch->GetListOfBranches();
+  for( int i=0; i < subbranches->GetEntriesFast(); i++ )
+    addBaskets( (TBranch*)subbranches->At(i), entries, ranges );
+}
+
+void MergerPrefetcher::prefetch( const std::string& fname, FileLayout* fl, int entry )
+{
+  std::vector<BasketRange> todo;
+  {
+    std::lock_guard<std::mutex> guard( fl->lock );
+    for( auto& range : fl->ranges )
+    {
+      if( range.first > entry ) break;
+      if( range.last < entry ) continue;
+      // Consecutive picks share baskets, issue each one once
+      if( fl->issued.insert( range.seek ).second )
+        todo.push_back( range );
+    }
+  }
+  if( todo.size() == 0 ) return;
+  int fd = open( fname.c_str(), O_RDONLY );
+  if( fd < 0 ) return;
+  for( auto& range : todo )
+  {
+    posix_fadvise( fd, range.seek, range.size, POSIX_FADV_WILLNEED );
+    baskets++;
+    bytes += range.size;
+  }
+  close( fd );
+}
+
+void MergerPrefetcher::print()
+{
+  printf("Prefetch: %ld requests, %ld baskets, %.1f MB\n",
+      long(requested), long(baskets), bytes / 1e6);
+}
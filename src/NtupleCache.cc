@@ -0,0 +1,127 @@
+#include <NtupleCache.hh>
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TNamed.h>
+#include <TObjArray.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdint>
+
+namespace
+{
+  const char* fingerprintKey = "fingerprint";
+
+  // FNV-1a, 64 bit
+  class Hash
+  {
+    public:
+      Hash() : h(14695981039346656037ULL) {};
+      void add( const void* data, size_t n )
+      {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for( size_t i=0; i < n; i++ )
+        {
+          h ^= p[i];
+          h *= 1099511628211ULL;
+        }
+      }
+      void add( const std::string& s ) { add( s.data(), s.size() ); }
+      void add( Long64_t x ) { add( &x, sizeof(x) ); }
+      std::string hex() const
+      {
+        char buf[17];
+        snprintf( buf, sizeof(buf), "%016llx", (unsigned long long)h );
+        return buf;
+      }
+      uint64_t h;
+  };
+
+  bool exists( const std::string& fname, struct stat& st )
+  {
+    return stat( fname.c_str(), &st ) == 0;
+  }
+
+  // Name, entries and basket table of b and of every branch below it:
+  // where each written basket starts in the file, its stored size and
+  // its first entry. Rewritten events move or resize baskets, and none
+  // of this reads the baskets themselves.
+  void addBaskets( Hash& tree, TBranch* b )
+  {
+    tree.add( std::string( b->GetName() ) );
+    tree.add( b->GetEntries() );
+    tree.add( b->GetTotBytes() );
+    tree.add( b->GetZipBytes() );
+    int written = b->GetWriteBasket();
+    tree.add( Long64_t( written ) );
+    Int_t* bytes = b->GetBasketBytes();
+    Long64_t* first = b->GetBasketEntry();
+    for( int i=0; i < written; i++ )
+    {
+      tree.add( b->GetBasketSeek(i) );
+      tree.add( Long64_t( bytes[i] ) );
+      tree.add( first[i] );
+    }
+    TObjArray* branches = b->GetListOfBranches();
+    for( int i=0; i < branches->GetEntriesFast(); i++ )
+      addBaskets( tree, (TBranch*)branches->At(i) );
+  }
+}
+
+NtupleCache::NtupleCache( std::string version, std::string config ) :
+  version(version)
+{
+  Hash hash;
+  hash.add( config );
+  configHash = hash.hex();
+}
+
+std::string NtupleCache::fingerprint( std::string iname )
+{
+  struct stat st;
+  if( !exists( iname, st ) ) return "";
+  TFile* tfile = new TFile( iname.c_str() );
+  TTree* T = tfile->IsZombie() ? nullptr : (TTree*)tfile->Get("T");
+  if( T == nullptr )
+  {
+    delete tfile;
+    return "";
+  }
+  Hash tree;
+  tree.add( T->GetEntries() );
+  TObjArray* branches = T->GetListOfBranches();
+  for( int i=0; i < branches->GetEntriesFast(); i++ )
+    addBaskets( tree, (TBranch*)branches->At(i) );
+  delete tfile;
+
+  char buf[256];
+  snprintf( buf, sizeof(buf), "size=%lld mtime=%lld.%09ld tree=%s",
+      (long long)st.st_size, (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec,
+      tree.hex().c_str() );
+  return std::string(buf) + " version=" + version + " config=" + configHash;
+}
+
+bool NtupleCache::upToDate( std::string oname, const std::string& fp )
+{
+  struct stat st;
+  if( fp.empty() || !exists( oname, st ) ) return false;
+  TFile* otfile = new TFile( oname.c_str() );
+  bool same = false;
+  if( !otfile->IsZombie() )
+  {
+    TNamed* stored = (TNamed*)otfile->Get( fingerprintKey );
+    same = stored != nullptr && fp == stored->GetTitle();
+  }
+  delete otfile;
+  return same;
+}
+
+void NtupleCache::record( std::string oname, const std::string& fp )
+{
+  if( fp.empty() ) return;
+  // Written last, an output cut short never carries a fingerprint
+  TFile* otfile = new TFile( oname.c_str(), "update" );
+  TNamed stored( fingerprintKey, fp.c_str() );
+  otfile->WriteObject( &stored, fingerprintKey, "WriteDelete" );
+  delete otfile;
+}
@@ -0,0 +1,126 @@
+#include <NtupleOutput.hh>
+#include <TKey.h>
+#include <iostream>
+#include <cstdlib>
+
+NtupleOutput::NtupleOutput( TTree* tree ) :
+  tree(tree), rows(0), file(nullptr)
+{
+}
+
+NtupleOutput::NtupleOutput( std::string name, TFile* file ) :
+  tree(nullptr), rows(0), name(name), file(file)
+{
+#ifdef NTUPLE_HAS_RNTUPLE
+  model = RNTupleAPI::RNTupleModel::Create();
+#else
+  std::cerr << "RNTuple output needs ROOT 6.32 or newer" << std::endl;
+  exit(EXIT_FAILURE);
+#endif
+}
+
+NtupleOutput::~NtupleOutput()
+{
+  Close();
+}
+
+bool NtupleOutput::rntupleSupported()
+{
+#ifdef NTUPLE_HAS_RNTUPLE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void NtupleOutput::Fill()
+{
+  rows++;
+  if( tree != nullptr )
+  {
+    tree->Fill();
+    return;
+  }
+#ifdef NTUPLE_HAS_RNTUPLE
+  if( writer == nullptr )
+    openWriter();
+  writer->Fill( *entry );
+#endif
+}
+
+#ifdef NTUPLE_HAS_RNTUPLE
+void NtupleOutput::openWriter()
+{
+  writer = RNTupleAPI::RNTupleWriter::Append( std::move(model), name, *file );
+  entry = writer->CreateEntry();
+  for( auto& b : bindings )
+    entry->BindRawPtr( b.first, b.second );
+}
+#endif
+
+void NtupleOutput::Close()
+{
+#ifdef NTUPLE_HAS_RNTUPLE
+  // Nothing filled yet: still write the header and footer. The model is
+  // gone once a writer was made, so a second Close adds nothing
+  if( writer == nullptr && model != nullptr )
+    openWriter();
+  // The writer commits its last cluster when destroyed
+  entry.reset();
+  writer.reset();
+#endif
+}
+
+NtupleReader::NtupleReader( std::string fname, std::string name ) :
+  tree(nullptr), isRNTuple(false)
+{
+  file = new TFile( fname.c_str() );
+  TKey* key = file->GetKey( name.c_str() );
+  if( key == nullptr )
+  {
+    std::cerr << "No " << name << " in " << fname << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  isRNTuple = std::string( key->GetClassName() ).find( "RNTuple" ) != std::string::npos;
+  if( !isRNTuple )
+  {
+    tree = (TTree*)file->Get( name.c_str() );
+    return;
+  }
+#ifdef NTUPLE_HAS_RNTUPLE
+  reader = RNTupleAPI::RNTupleReader::Open( name, fname );
+#else
+  std::cerr << fname << " holds an RNTuple, which needs ROOT 6.32 or newer" << std::endl;
+  exit(EXIT_FAILURE);
+#endif
+}
+
+NtupleReader::~NtupleReader()
+{
+  loaders.clear();
+#ifdef NTUPLE_HAS_RNTUPLE
+  reader.reset();
+#endif
+  delete file;
+}
+
+Long64_t NtupleReader::GetEntries()
+{
+  if( tree != nullptr ) return tree->GetEntries();
+#ifdef NTUPLE_HAS_RNTUPLE
+  return reader->GetNEntries();
+#else
+  return 0;
+#endif
+}
+
+void NtupleReader::GetEvent( Long64_t i )
+{
+  if( tree != nullptr )
+  {
+    tree->GetEvent( i );
+    return;
+  }
+  for( auto& load : loaders )
+    load( i );
+}
@@ -0,0 +1,60 @@
+#include <PMTGeometry.hh>
+#include <TVector3.h>
+
+PMTGeometry::PMTGeometry( RAT::DS::PMTInfo* pmtinfo ) :
+  pmtinfo(pmtinfo), count( pmtinfo->GetPMTCount() )
+{
+  type.resize( count );
+  x.resize( count );
+  y.resize( count );
+  z.resize( count );
+  u.resize( count );
+  v.resize( count );
+  w.resize( count );
+  for( int i=0; i < count; i++ )
+  {
+    type[i] = pmtinfo->GetType(i);
+    TVector3 pos = pmtinfo->GetPosition(i);
+    TVector3 dir = pmtinfo->GetDirection(i);
+    double mag = dir.Mag();
+    if( mag > 0 ) dir = (1.0/mag) * dir;
+    x[i] = pos.X();
+    y[i] = pos.Y();
+    z[i] = pos.Z();
+    u[i] = dir.X();
+    v[i] = dir.Y();
+    w[i] = dir.Z();
+    std::vector<unsigned char>& m = masks[ type[i] ];
+    if( m.size() == 0 ) m.resize( count, 0 );
+    m[i] = 1;
+    idlists[ type[i] ].push_back( i );
+  }
+}
+
+const std::vector<unsigned char>& PMTGeometry::mask( int t )
+{
+  std::vector<unsigned char>& m = masks[t];
+  if( m.size() == 0 ) m.resize( count, 0 );
+  return m;
+}
+
+const std::vector<int>& PMTGeometry::ids( int t )
+{
+  return idlists[t];
+}
+
+bool PMTGeometry::matches( RAT::DS::PMTInfo* other ) const
+{
+  if( other->GetPMTCount() != count ) return false;
+  for( int i=0; i < count; i++ )
+  {
+    if( other->GetType(i) != type[i] ) return false;
+    TVector3 pos = other->GetPosition(i);
+    TVector3 dir = other->GetDirection(i);
+    double mag = dir.Mag();
+    if( mag > 0 ) dir = (1.0/mag) * dir;
+    if( pos.X() != x[i] || pos.Y() != y[i] || pos.Z() != z[i] ) return false;
+    if( dir.X() != u[i] || dir.Y() != v[i] || dir.Z() != w[i] ) return false;
+  }
+  return true;
+}
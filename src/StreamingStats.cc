@@ -0,0 +1,174 @@
+#include <StreamingStats.hh>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+TDigest::TDigest( double compression ) :
+  compression(compression), total(0), buffered(0),
+  min(std::numeric_limits<double>::infinity()), max(-std::numeric_limits<double>::infinity())
+{
+  buffer.reserve( 5 * compression );
+}
+
+void TDigest::add( double x, double w )
+{
+  Centroid c = { x, w };
+  buffer.push_back( c );
+  buffered += w;
+  min = std::min( min, x );
+  max = std::max( max, x );
+  if( buffer.size() >= 5 * compression )
+    compress();
+}
+
+void TDigest::merge( const TDigest& other )
+{
+  for( auto& c : other.centroids )
+    buffer.push_back( c );
+  for( auto& c : other.buffer )
+    buffer.push_back( c );
+  buffered += other.total + other.buffered;
+  min = std::min( min, other.min );
+  max = std::max( max, other.max );
+  compress();
+}
+
+void TDigest::compress()
+{
+  if( buffer.size() == 0 ) return;
+  for( auto& c : centroids )
+    buffer.push_back( c );
+  std::sort( buffer.begin(), buffer.end(),
+      []( const Centroid& a, const Centroid& b ){ return a.mean < b.mean; } );
+  double sum = total + buffered;
+  centroids.clear();
+  Centroid current = buffer[0];
+  double before = 0;   // weight left of current
+  for( size_t i=1; i < buffer.size(); i++ )
+  {
+    double proposed = current.weight + buffer[i].weight;
+    double q = ( before + proposed / 2 ) / sum;
+    // Size bound 4 n q (1 - q) / compression keeps the tails fine grained
+    if( proposed <= 4 * sum * q * (1 - q) / compression )
+    {
+      current.mean += ( buffer[i].mean - current.mean ) * buffer[i].weight / proposed;
+      current.weight = proposed;
+    }
+    else
+    {
+      before += current.weight;
+      centroids.push_back( current );
+      current = buffer[i];
+    }
+  }
+  centroids.push_back( current );
+  total = sum;
+  buffered = 0;
+  buffer.clear();
+}
+
+double TDigest::quantile( double q )
+{
+  compress();
+  if( centroids.size() == 0 ) return std::numeric_limits<double>::quiet_NaN();
+  if( centroids.size() == 1 ) return centroids[0].mean;
+  q = std::min( 1.0, std::max( 0.0, q ) );
+  double index = q * total;
+  // Centroid centres sit at the middle of their weight; the extremes are
+  // interpolated towards the exact minimum and maximum
+  double at = centroids[0].weight / 2;
+  if( index <= at )
+    return min + ( centroids[0].mean - min ) * index / at;
+  for( size_t i=0; i + 1 < centroids.size(); i++ )
+  {
+    double step = ( centroids[i].weight + centroids[i+1].weight ) / 2;
+    if( index <= at + step )
+      return centroids[i].mean + ( centroids[i+1].mean - centroids[i].mean ) * ( index - at ) / step;
+    at += step;
+  }
+  const Centroid& last = centroids.back();
+  return std::min( max, last.mean + ( max - last.mean ) * ( index - at ) / ( last.weight / 2 ) );
+}
+
+StreamingStats::StreamingStats( double compression ) :
+  n(0), compression(compression), m(0), m2(0), digest(compression), counting(true)
+{
+}
+
+void StreamingStats::add( double x )
+{
+  n++;
+  double d = x - m;
+  m += d / n;
+  m2 += d * ( x - m );
+  digest.add( x );
+  if( !counting ) return;
+  // Integers exactly representable as doubles only
+  if( std::floor( x ) == x && std::fabs( x ) < 9007199254740992.0 )
+  {
+    histogram[ (long long)x ]++;
+    if( histogram.size() <= maxDistinct ) return;
+  }
+  counting = false;
+  histogram.clear();
+}
+
+void StreamingStats::merge( const StreamingStats& other )
+{
+  if( other.n == 0 ) return;
+  long long total = n + other.n;
+  double d = other.m - m;
+  m2 += other.m2 + d * d * n * other.n / total;
+  m += d * other.n / total;
+  n = total;
+  digest.merge( other.digest );
+  if( counting && other.counting )
+  {
+    for( auto& h : other.histogram )
+      histogram[ h.first ] += h.second;
+    if( histogram.size() <= maxDistinct ) return;
+  }
+  counting = false;
+  histogram.clear();
+}
+
+void StreamingStats::clear()
+{
+  n = 0;
+  m = 0;
+  m2 = 0;
+  digest = TDigest( compression );
+  counting = true;
+  histogram.clear();
+}
+
+double StreamingStats::mean() const
+{
+  return n > 0 ? m : std::numeric_limits<double>::quiet_NaN();
+}
+
+double StreamingStats::variance() const
+{
+  return n > 0 ? m2 / n : std::numeric_limits<double>::quiet_NaN();
+}
+
+double StreamingStats::stddev() const
+{
+  return sqrt( variance() );
+}
+
+double StreamingStats::quantile( double q )
+{
+  if( !counting || n == 0 )
+    return digest.quantile( q );
+  q = std::min( 1.0, std::max( 0.0, q ) );
+  // Rank of the value, 1 .. n; the slack keeps 0.05 * 100 at rank 5
+  double rank = std::max( 1.0, std::ceil( q * n - 1e-9 ) );
+  long long below = 0;
+  for( auto& h : histogram )
+  {
+    below += h.second;
+    if( below >= rank ) return h.first;
+  }
+  return histogram.rbegin()->first;
+}
@@ -11,6 +11,7 @@
 #include <TMath.h>
 #include <TVector3.h>
 #include <TGraph.h>
+#include <NtupleOutput.hh>
 
 #include <RAT/DS/Root.hh>
 #include <RAT/DS/Run.hh>
@@ -29,10 +30,9 @@ TH2D MakeCDF(TH2D h, string name);
 
 void marcfile(string iname, string oname, string hname, double radius, int subevchoice, int replace)
 {
-  // Input file
-  unique_ptr<TFile> tfile(new TFile(iname.c_str()));
-  TTree* t = (TTree*)tfile->Get("output");
-  TTree* m = (TTree*)tfile->Get("meta");
+  // Input file, the output rows either as TTree or RNTuple
+  NtupleReader t(iname);
+  TTree* m = (TTree*)t.file->Get("meta");
 
   // Start with meta
   double eff = 0;
@@ -42,14 +42,14 @@ void marcfile(string iname, string oname, string hname, double radius, int subev
   // Main Tree
   double x, y, z, chi2, mcke;
   int n100, n400, subev;
-  t->SetBranchAddress("x", &x);
-  t->SetBranchAddress("y", &y);
-  t->SetBranchAddress("z", &z);
-  t->SetBranchAddress("mcke", &mcke);
-  t->SetBranchAddress("n100", &n100);
-  t->SetBranchAddress("chi2", &chi2);
-  t->SetBranchAddress("n400", &n400);
-  t->SetBranchAddress("subev", &subev);
+  t.SetBranchAddress("x", &x);
+  t.SetBranchAddress("y", &y);
+  t.SetBranchAddress("z", &z);
+  t.SetBranchAddress("mcke", &mcke);
+  t.SetBranchAddress("n100", &n100);
+  t.SetBranchAddress("chi2", &chi2);
+  t.SetBranchAddress("n400", &n400);
+  t.SetBranchAddress("subev", &subev);
 
   // replace?
   unique_ptr<TFile> gfile(new TFile("ibdgraph.root"));
@@ -67,9 +67,9 @@ void marcfile(string iname, string oname, string hname, double radius, int subev
   int events_simulated = 0;
   int events_passed = 0;
 
-  for(unsigned ev=0; ev<t->GetEntries(); ev++)
+  for(unsigned ev=0; ev<t.GetEntries(); ev++)
   {
-    t->GetEvent(ev);
+    t.GetEvent(ev);
     if(subev == subevchoice || subev == -1)
     {
       events_simulated++;
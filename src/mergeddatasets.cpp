@@ -4,9 +4,14 @@
 #include <vector>
 #include <unistd.h>
 #include <ctime>
+#include <chrono>
+#include <algorithm>
 #include <MergerConfig.hh>
 #include <MergerParser.hh>
 #include <MergerChainFactory.hh>
+#include <MergerEventCache.hh>
+#include <MergerPrefetcher.hh>
+#include <ColumnEngine.hh>
 
 #include <RAT/DS/Root.hh>
 #include <RAT/DS/Run.hh>
@@ -17,51 +22,213 @@
 #include <TTree.h>
 #include <TRandom3.h>
 
+void writeDataset(MergerChainFactory& factory, MergerConfig* config, MergerParser& parser, int loop);
+
 int main(int argc, char** argv)
 {
   // Parse commands
   std::vector<std::string> argument_vector(argv+1, argv+argc);
   MergerParser parser( argument_vector );
 
-  // Read the config.json file to get event types, locations, and rates
-  MergerConfig* config = new MergerConfig( parser.config, parser.subdir );
-  if( parser.verbose ) config->print();
+  // Read the config.json file to get event types, locations, and rates,
+  // once per target of a sweep
+  std::vector<MergerConfig*> configs;
+  for( auto target : parser.subdirs )
+  {
+    configs.push_back( new MergerConfig( parser.config, target ) );
+    if( parser.verbose ) configs.back()->print();
+  }
+  MergerConfig* config = configs[0];
 
   TRandom3* rndm = new TRandom3();
   // Unique seeding time * pid
   long seed = time(nullptr) * getpid();
   rndm->SetSeed(seed);
 
+  // Processes on the same node share events through this cache
+  MergerEventCache* cache = nullptr;
+  if( parser.shmCache != "" )
+    cache = new MergerEventCache( parser.shmCache, uint64_t(parser.shmSize * 1024 * 1024) );
+  // Source reads overlap with timeline sampling; a dry run reads nothing
+  MergerPrefetcher* prefetcher = nullptr;
+  if( parser.prefetch > 0 && !parser.dryRun )
+    prefetcher = new MergerPrefetcher( parser.prefetch, config->dstree );
+
   // Main loop
   for(int loop=parser.start; loop<(parser.num+parser.start); ++loop)
   {
     // Build input TChains
-    MergerChainFactory factory( config, rndm, parser.superverbose );
+    std::vector<MergerChainFactory*> factories;
+    for( auto target_config : configs )
+    {
+      factories.push_back( new MergerChainFactory( target_config, rndm, parser.superverbose ) );
+      factories.back()->coincidenceOnly = parser.coincidenceOnly;
+      if( cache != nullptr )
+        factories.back()->setCache( cache );
+      if( prefetcher != nullptr )
+        factories.back()->setPrefetcher( prefetcher );
+    }
+    MergerChainFactory& factory = *factories[0];
+    // The timeline is drawn from the first target's rates and header
+    // efficiencies; a target with others would get its rates and livetime
+    for( int t=1; t < factories.size(); t++ )
+    {
+      if( !factory.sameSampling( *factories[t] ) )
+      {
+        std::cerr << "Target " << parser.subdirs[t] << " does not share the rates and efficiencies of "
+                  << parser.subdirs[0] << ", sweep them separately" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
     // Loop in time, grabbing entries based on poisson of rate
     double start_time = 0.0;
     if( parser.verbose )
       printf("Event: %i\n", loop);
+    bool ratescan = config->rateScan.size() > 0;
+    // A sweep samples the timeline once and replays it on every target
+    bool sweep = factories.size() > 1;
+    // Memory the dry run estimate starts from, before sampling adds to it
+    double baseline = parser.dryRun ? MergerChainFactory::residentBytes() : 0;
+    auto sample_start = std::chrono::steady_clock::now();
     while( start_time < parser.time )
     {
       // if( parser.verbose )
       //   printf("\tTime: %f / %f\r", start_time, parser.time);
-      double next_time = factory.nextEvent();
+      double next_time = ( ratescan || sweep ) ? factory.nextRawEvent() : factory.nextEvent();
+      // Each target of a sweep reads its own files for the same picks
+      for( int t=1; t < factories.size(); t++ )
+        factories[t]->prefetchPick( factory.rawTimeline.back() );
       start_time = next_time;
     }
+    if( !( ratescan || sweep ) )
+      factory.flushSelection();
+    double sample_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - sample_start ).count();
+    std::vector<RawPick> timeline = factory.rawTimeline;
+    for( int t=0; t < factories.size(); t++ )
+    {
+      MergerChainFactory& target = *factories[t];
+      target.rawTimeline = timeline;
+      if( sweep && parser.verbose )
+        printf("Target: %s\n", parser.subdirs[t].c_str());
+      if( parser.dryRun )
+      {
+        printf("Dataset %i %s\n", loop, parser.subdirs[t].c_str());
+        if( ratescan )
+        {
+          double maxscale = *std::max_element( config->rateScan.begin(), config->rateScan.end() );
+          for( auto scale : config->rateScan )
+          {
+            printf("Rate scale %f\n", scale);
+            target.replayTimeline( scale / maxscale );
+            target.printEstimate( sample_seconds, baseline );
+            for( auto mtc : target.chainList ) mtc->reset();
+          }
+        }
+        else
+        {
+          if( sweep ) target.replayTimeline( 1.0 );
+          target.printEstimate( sample_seconds, baseline );
+        }
+        target.rawTimeline.clear();
+        target.finishDataset();
+        continue;
+      }
+      if( ratescan )
+      {
+        // One output per rate point, all derived from this timeline
+        std::vector<std::string> scan_names;
+        for( auto scale : config->rateScan )
+        {
+          std::stringstream ss;
+          ss << "mergedfile_" << loop << "_scale" << scale << ".root";
+          scan_names.push_back( ss.str() );
+        }
+        if( parser.verbose )
+          printf("Sampled events: %i\n", int(target.rawTimeline.size()));
+        target.buildRateScan( config->rateScan, scan_names );
+        continue;
+      }
+      if( sweep )
+      {
+        target.replayTimeline( 1.0 );
+        target.rawTimeline.clear();
+      }
+      writeDataset( target, configs[t], parser, loop );
+    }
+    for( auto p : factories ) delete p;
+    std::cout << "Processed " << loop << " of " << parser.num << "\r" << std::flush;
+  }
+
+  if( prefetcher != nullptr )
+  {
+    if( parser.verbose ) prefetcher->print();
+    delete prefetcher;
+  }
+  if( cache != nullptr )
+  {
+    if( parser.verbose ) cache->print();
+    delete cache;
+  }
+  delete rndm;
+  for( auto p : configs ) delete p;
+  return 0;
+}
+
+void writeDataset(MergerChainFactory& factory, MergerConfig* config, MergerParser& parser, int loop)
+{
+  if( parser.verbose )
+    printf("Total events: %i\n", factory.timeComponentMap.size());
+  // File name
+  std::stringstream ss;
+  ss << "mergedfile_" << loop << ".root";
+  std::string outfile_name = ss.str();
+  if( parser.ntuple )
+  {
+    // Feature extraction straight from the merged timeline, the full
+    // RAT file is only written when teeing
+    std::stringstream ns;
+    ns << config->trainingDir << "/mergedntuple_" << loop << ".root";
     if( parser.verbose )
-      printf("Total events: %i\n", factory.timeComponentMap.size());
-    // File name
-    std::stringstream ss;
-    ss << "mergedfile_" << loop << ".root";
-    std::string outfile_name = ss.str();
+      printf("::Writing ntuple to %s\n", ns.str().c_str());
+    factory.buildEvents();
+    if( parser.tee )
+      factory.openNewFile( outfile_name );
+    RAT::DS::Run* run = factory.getRun();
+    TFile* otfile = new TFile(ns.str().c_str(), "recreate");
+    TTree* output = new TTree("output", "output");
+    TTree* meta = new TTree("meta", "meta");
+    // Coincidence-only bookkeeping goes with the ntuple too, it is the
+    // only record of the summarized singles when not teeing
+    if( factory.coincidenceOnly )
+      factory.writeSingles();
+    // The mkntuple columns, filled from the events as they are merged
+    ColumnEngine* engine = ColumnEngine::standard();
+    engine->open( run->GetPMTInfo() );
+    NtupleOutput rows( output );
+    engine->NewBranches( &rows );
+    MergedEvent evt;
+    while( factory.nextMergedEvent( evt ) )
+    {
+      if( parser.tee )
+        factory.fillNewFile( evt );
+      engine->fill( evt.ds, evt.name, &rows );
+    }
+    engine->fillMeta( meta, factory.timenow );
+    delete engine;
+    otfile->Write(0, TObject::kOverwrite);
+    otfile->Close();
+    delete otfile;
+    delete run;
+    if( parser.tee )
+      factory.closeNewFile();
+    factory.finishDataset();
+  }
+  else
+  {
     if( parser.verbose )
       printf("::Writing out to %s\n", outfile_name.c_str());
     // Build data file
     factory.buildNewFile( outfile_name );
-    std::cout << "Processed " << loop << " of " << parser.num << "\r" << std::flush;
   }
-
-  delete rndm;
-  delete config;
-  return 0;
 }
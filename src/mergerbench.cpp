@@ -0,0 +1,296 @@
+// Throughput benchmark for the merger. Generates synthetic component
+// directories (T, runT, header and posdb trees) and then times the
+// MergerChainFactory end to end and stage by stage, so merger changes can be
+// evaluated without access to the production trees.
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <MergerConfig.hh>
+#include <MergerChainFactory.hh>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TRandom3.h>
+#include <TVector3.h>
+
+#include <RAT/DS/Root.hh>
+#include <RAT/DS/Run.hh>
+#include <RAT/DS/MC.hh>
+#include <RAT/DS/EV.hh>
+#include <RAT/DS/MCParticle.hh>
+#include <RAT/DS/PathFit.hh>
+#include <RAT/DS/PMTInfo.hh>
+
+using namespace std;
+
+class BenchParams
+{
+  public:
+    string outdir     = "mergerbench_data";
+    int components    = 3;
+    int files         = 4;
+    int events        = 1000;
+    int hits          = 200;
+    int pmts          = 2000;
+    double rate       = 10;
+    double time       = 60;
+    double deltat     = 1e-3;
+    double deltar     = 2000;
+    long seed         = 4357;
+    bool generate     = true;
+};
+
+class BenchTimer
+{
+  public:
+    BenchTimer() : start(chrono::steady_clock::now()) {}
+    double seconds()
+    {
+      return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+    }
+  private:
+    chrono::steady_clock::time_point start;
+};
+
+double peakRSS()
+{
+  // ru_maxrss is reported in kilobytes on Linux
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+void report(string stage, double seconds, double events, double mbytes)
+{
+  printf("%-22s %9.3f s %12.1f evt/s %9.2f MB/s  peak RSS %8.1f MB\n",
+      stage.c_str(), seconds, events / seconds, mbytes / seconds, peakRSS());
+}
+
+void generateComponent(BenchParams& p, string dir, TRandom3* rndm)
+{
+  boost::filesystem::create_directories( dir );
+  // Every file carries the same detector so PMTInfo is built once
+  RAT::DS::PMTInfo pmtinfo;
+  for(int i=0; i<p.pmts; i++)
+  {
+    double x, y, z;
+    rndm->Sphere(x, y, z, 6700);
+    TVector3 pos(x, y, z);
+    pmtinfo.AddPMT( pos, -1*pos.Unit(), (i % 10 == 0) ? 2 : 1 );
+  }
+  RAT::DS::Run* run = new RAT::DS::Run();
+  run->SetID(0);
+  run->SetPMTInfo( &pmtinfo );
+
+  for(int f=0; f<p.files; f++)
+  {
+    stringstream ss;
+    ss << dir << "/bench_" << f << ".root";
+    TFile* tfile = new TFile(ss.str().c_str(), "recreate");
+
+    TTree* runT = new TTree("runT", "runT");
+    runT->Branch("run", &run);
+    runT->Fill();
+
+    TTree* header = new TTree("header", "header");
+    double efficiency = 1.0;
+    header->Branch("efficiency", &efficiency);
+    header->Fill();
+
+    vector<double> xdb, ydb, zdb;
+    TTree* dbtree = new TTree("posdb", "posdb");
+    dbtree->Branch("xdb", &xdb);
+    dbtree->Branch("ydb", &ydb);
+    dbtree->Branch("zdb", &zdb);
+
+    TTree* T = new TTree("T", "T");
+    RAT::DS::Root* ds = new RAT::DS::Root();
+    T->Branch("ds", &ds);
+    for(int i=0; i<p.events; i++)
+    {
+      *ds = RAT::DS::Root();
+      double x, y, z;
+      rndm->Sphere(x, y, z, rndm->Uniform(5000));
+      TVector3 pos(x, y, z);
+      RAT::DS::MCParticle* particle = ds->GetMC()->AddNewMCParticle();
+      particle->SetPDGCode( 11 );
+      particle->SetKE( rndm->Uniform(10) );
+      particle->SetPosition( pos );
+      particle->SetMomentum( TVector3(0, 0, 1) );
+
+      RAT::DS::EV* ev = ds->AddNewEV();
+      ev->SetID( i );
+      ev->SetCalibratedTriggerTime( 0 );
+      ev->GetPathFit()->SetPosition( pos );
+      ev->GetPathFit()->SetDirection( TVector3(0, 0, 1) );
+      for(int h=0; h<p.hits; h++)
+      {
+        RAT::DS::PMT* pmt = ev->AddNewPMT();
+        pmt->SetID( int( rndm->Rndm() * p.pmts ) );
+        pmt->SetTime( rndm->Uniform(-200, 600) );
+        pmt->SetCharge( rndm->Exp(1.0) );
+      }
+      xdb.push_back( pos.X() );
+      ydb.push_back( pos.Y() );
+      zdb.push_back( pos.Z() );
+      T->Fill();
+    }
+    dbtree->Fill();
+    tfile->Write(0, TObject::kOverwrite);
+    tfile->Close();
+    delete tfile;
+    delete ds;
+    printf("Generated %s\r", ss.str().c_str());
+    fflush(stdout);
+  }
+  printf("\n");
+  delete run;
+}
+
+string generateConfig(BenchParams& p)
+{
+  namespace pt = boost::property_tree;
+  string base = p.outdir + "/base";
+  pt::ptree iroot, header, components;
+  header.put( "base_directory", base );
+  header.put( "training_directory", p.outdir + "/training" );
+  header.put( "sample_directory", p.outdir + "/sample" );
+  header.put( "dstree", "T" );
+  header.put( "dsbranch", "ds" );
+  header.put( "deltat", p.deltat );
+  header.put( "deltar", p.deltar );
+  iroot.add_child( "header", header );
+
+  TRandom3* rndm = new TRandom3( p.seed );
+  for(int c=0; c<p.components; c++)
+  {
+    stringstream ss;
+    ss << "component_" << c;
+    pt::ptree component;
+    component.put( "name", ss.str() );
+    component.put( "directory", ss.str() );
+    component.put( "rate", p.rate );
+    // Alternate classes so both coincidence paths are exercised
+    component.put( "class", (c % 2 == 0) ? "single" : "multi" );
+    components.push_back( std::make_pair("", component) );
+    if( p.generate )
+      generateComponent( p, base + "/" + ss.str(), rndm );
+  }
+  iroot.add_child( "components", components );
+  delete rndm;
+
+  boost::filesystem::create_directories( p.outdir + "/training" );
+  string config_file = p.outdir + "/config.json";
+  pt::write_json( config_file, iroot );
+  return config_file;
+}
+
+double fileMB(string fname)
+{
+  return boost::filesystem::file_size( fname ) / 1e6;
+}
+
+void help()
+{
+  cout << "mergerbench <options>" << endl;
+  cout << "    -h,--help        : Print help dialog" << endl;
+  cout << "    -o,--outdir      : Directory for synthetic inputs and outputs" << endl;
+  cout << "    -c,--components  : Number of components" << endl;
+  cout << "    -f,--files       : Files per component" << endl;
+  cout << "    -e,--events      : Events per file" << endl;
+  cout << "    -p,--hits        : PMT hits per event (event size)" << endl;
+  cout << "    -r,--rate        : Rate of each component (Hz)" << endl;
+  cout << "    -t,--time        : Length of merged dataset (seconds)" << endl;
+  cout << "    -s,--seed        : Random seed" << endl;
+  cout << "    --no-generate    : Reuse inputs already in outdir" << endl;
+  exit(EXIT_SUCCESS);
+}
+
+BenchParams parse(vector<string> args)
+{
+  BenchParams p;
+  string iv = "";
+  for( auto v : args )
+  {
+    if( v == "-h" || v == "--help" ) help();
+    if( v == "--no-generate" ) p.generate = false;
+    if( iv == "-o" || iv == "--outdir" ) p.outdir = v;
+    if( iv == "-c" || iv == "--components" ) p.components = stoi(v);
+    if( iv == "-f" || iv == "--files" ) p.files = stoi(v);
+    if( iv == "-e" || iv == "--events" ) p.events = stoi(v);
+    if( iv == "-p" || iv == "--hits" ) p.hits = stoi(v);
+    if( iv == "-r" || iv == "--rate" ) p.rate = stod(v);
+    if( iv == "-t" || iv == "--time" ) p.time = stod(v);
+    if( iv == "-s" || iv == "--seed" ) p.seed = stol(v);
+    iv = v;
+  }
+  return p;
+}
+
+int main(int argc, char** argv)
+{
+  vector<string> args(argv+1, argv+argc);
+  BenchParams p = parse(args);
+
+  BenchTimer gentimer;
+  string config_file = generateConfig(p);
+  if( p.generate )
+    report("generate", gentimer.seconds(), p.components*p.files*p.events, 0);
+
+  MergerConfig* config = new MergerConfig( config_file, "" );
+  TRandom3* rndm = new TRandom3( p.seed );
+
+  printf("\n---- End to end ----\n");
+  {
+    Long64_t bytes0 = TFile::GetFileBytesRead();
+    BenchTimer timer;
+    MergerChainFactory factory( config, rndm, false );
+    while( factory.nextEvent() < p.time );
+    factory.flushSelection();
+    double events = factory.timeComponentMap.size();
+    string outname = config->trainingDir + "/mergerbench_e2e.root";
+    factory.buildNewFile( "mergerbench_e2e.root" );
+    double seconds = timer.seconds();
+    double mbread = (TFile::GetFileBytesRead() - bytes0) / 1e6;
+    report("end-to-end (read)", seconds, events, mbread);
+    report("end-to-end (write)", seconds, events, fileMB(outname));
+  }
+
+  printf("\n---- Stages ----\n");
+  {
+    rndm->SetSeed( p.seed );
+    BenchTimer setup;
+    MergerChainFactory factory( config, rndm, false );
+    report("setup (header/posdb)", setup.seconds(), 0, 0);
+
+    BenchTimer sampling;
+    long picks = 0;
+    while( factory.nextEvent() < p.time ) picks++;
+    factory.flushSelection();
+    double events = factory.timeComponentMap.size();
+    report("nextEvent", sampling.seconds(), picks, 0);
+
+    Long64_t bytes0 = TFile::GetFileBytesRead();
+    BenchTimer building;
+    factory.buildEvents();
+    double mbread = (TFile::GetFileBytesRead() - bytes0) / 1e6;
+    report("eventBuilder", building.seconds(), events, mbread);
+
+    BenchTimer writing;
+    string outname = config->trainingDir + "/mergerbench_stages.root";
+    factory.writeNewFile( "mergerbench_stages.root" );
+    report("buildNewFile (write)", writing.seconds(), events, fileMB(outname));
+  }
+
+  delete rndm;
+  delete config;
+  return 0;
+}
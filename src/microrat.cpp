@@ -3,7 +3,12 @@
 #include <vector>
 #include <numeric>
 #include <sstream>
+#include <chrono>
 #include <MicroDS.hh>
+#include <HitColumns.hh>
+#include <BatchJobs.hh>
+#include <DSBranchSelector.hh>
+#include <StreamingStats.hh>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -23,17 +28,52 @@ using namespace std;
 // which will preserve some of the properties of the ratds (so not flat
 // or easy to parse) but reduced in size.
 
-void microfile(string iname, string oname);
+void microfile(string iname, string oname, MicroDS* mds, HitColumns* hits, bool rntuple);
 int NhitsX(RAT::DS::EV* ev, double minT, double maxT);
 
 int main(int argc, char** argv)
 {
-  // One file at a time, specify in / out
-  microfile(argv[1], argv[2]);
+  // Either one input / output pair, or many inputs (files, globs or a
+  // manifest) processed in this one process
+  vector<string> args(argv+1, argv+argc);
+  vector<string> files;
+  string manifest, outdir;
+  bool rntuple = false;
+  bool withHits = false;
+  for( size_t i=0; i < args.size(); i++ )
+  {
+    // Write the micro rows as an RNTuple instead of a TTree
+    if( args[i] == "--rntuple" ) rntuple = true;
+    // Also keep the PMT hits of every EV as packed columns
+    else if( args[i] == "--hits" ) withHits = true;
+    else if( args[i] == "--manifest" && i+1 < args.size() ) manifest = args[++i];
+    else if( args[i] == "--outdir" && i+1 < args.size() ) outdir = args[++i];
+    else files.push_back(args[i]);
+  }
+  if( files.size() == 0 && manifest.empty() )
+  {
+    cerr << "usage: microrat input.root output.root [--rntuple] [--hits]" << endl;
+    cerr << "       microrat --outdir DIR [--manifest list.txt] [inputs or 'globs' ...]" << endl;
+    exit(EXIT_FAILURE);
+  }
+  BatchJobs batch( files, manifest, outdir );
+  // One event buffer for every file; its vectors keep their capacity, so
+  // events stop allocating once the largest has been seen
+  MicroDS* mds = new MicroDS();
+  mds->reserve( 8, 8 );
+  HitColumns* hits = withHits ? new HitColumns() : nullptr;
+  for( auto& job : batch.jobs )
+  {
+    if( batch.jobs.size() > 1 )
+      printf("%s -> %s\n", job.first.c_str(), job.second.c_str());
+    microfile(job.first, job.second, mds, hits, rntuple);
+  }
+  delete mds;
+  delete hits;
   return 0;
 }
 
-void microfile(string iname, string oname)
+void microfile(string iname, string oname, MicroDS* mds, HitColumns* hits, bool rntuple)
 {
   // Load the data
   TFile* tfile = new TFile(iname.c_str());
@@ -43,27 +83,41 @@ void microfile(string iname, string oname)
   int entries = T->GetEntries();
   RAT::DS::Root* ds = new RAT::DS::Root();
   string* dsname = new string();
+  // Summaries only, the MC PMTs, photons and tracks are never read
+  DSBranchSelector selector( T, DSBranchSelector::EV | DSBranchSelector::PMTs |
+      DSBranchSelector::PathFit | DSBranchSelector::MC | DSBranchSelector::MCParticles );
+  selector.report();
   T->SetBranchAddress("ds", &ds, 0);
   // T->SetBranchAddress("name", &dsname);
 
   // Storage File / Tree
   TFile* otfile = new TFile(oname.c_str(), "recreate");
-  TTree* output = new TTree("micro", "micro");
+  NtupleOutput* output;
+  if( rntuple )
+    output = new NtupleOutput("micro", otfile);
+  else
+    output = new NtupleOutput(new TTree("micro", "micro"));
   TTree* meta   = new TTree("meta", "meta");
   TTree* header = head->CloneTree(0);
   head->GetEvent(0);
   header->Fill();
 
-  MicroDS* mds = new MicroDS();
-  mds->NewBranches( output );
+  if( rntuple )
+    mds->NewBranches( output );
+  else
+    mds->NewBranches( output->tree );
+  if( hits != nullptr )
+    hits->NewBranches( output );
 
   // Store for meta
-  vector<double> vPed; // pedestals
+  StreamingStats pedestals;
 
   // Loop through events
+  auto start = chrono::steady_clock::now();
   for( int i=0; i < entries; i++ )
   {
     mds->cleardata();
+    if( hits != nullptr ) hits->cleardata();
 
     // Get New Event
     T->GetEvent(i);
@@ -75,51 +129,74 @@ void microfile(string iname, string oname)
     for( int p=0; p<mds->mcpcount; p++ )
     {
       RAT::DS::MCParticle* particle = mc->GetMCParticle(p);
-      mds->pdgcodes->push_back( particle->GetPDGCode() );
-      mds->mcKEnergies->push_back( particle->GetKE() );
+      mds->pdgcodes.push_back( particle->GetPDGCode() );
+      mds->mcKEnergies.push_back( particle->GetKE() );
       TVector3 mcpos = particle->GetPosition();
       TVector3 mcdir = particle->GetMomentum();
-      mds->mcPosx->push_back( mcpos.X() );
-      mds->mcPosy->push_back( mcpos.Y() );
-      mds->mcPosz->push_back( mcpos.Z() );
-      mds->mcDirx->push_back( mcdir.X()/mcdir.Mag() );
-      mds->mcDiry->push_back( mcdir.Y()/mcdir.Mag() );
-      mds->mcDirz->push_back( mcdir.Z()/mcdir.Mag() );
+      mds->mcPosx.push_back( mcpos.X() );
+      mds->mcPosy.push_back( mcpos.Y() );
+      mds->mcPosz.push_back( mcpos.Z() );
+      mds->mcDirx.push_back( mcdir.X()/mcdir.Mag() );
+      mds->mcDiry.push_back( mcdir.Y()/mcdir.Mag() );
+      mds->mcDirz.push_back( mcdir.Z()/mcdir.Mag() );
     }
     // Store aggregate particle info (first position, sum of ke)
     // Get Sub Events and write to ttree
+    mds->evcount = ds->GetEVCount();
     for( int sub=0; sub < ds->GetEVCount(); sub++ )
     {
       RAT::DS::EV* ev = ds->GetEV(sub);
-      mds->subev->push_back(sub);
-      mds->triggertime->push_back( ev->GetCalibratedTriggerTime() );
+      mds->subev.push_back(sub);
+      mds->triggertime.push_back( ev->GetCalibratedTriggerTime() );
       RAT::DS::PathFit* fit = ev->GetPathFit();
       TVector3 pos = fit->GetPosition();
-      mds->x->push_back(pos.X());
-      mds->y->push_back(pos.Y());
-      mds->z->push_back(pos.Z());
+      mds->x.push_back(pos.X());
+      mds->y.push_back(pos.Y());
+      mds->z.push_back(pos.Z());
       TVector3 dir = fit->GetDirection();
-      mds->u->push_back(dir.X());
-      mds->v->push_back(dir.Y());
-      mds->w->push_back(dir.Z());
+      mds->u.push_back(dir.X());
+      mds->v.push_back(dir.Y());
+      mds->w.push_back(dir.Z());
       int pedcount = NhitsX(ev, -150, -50);
-      mds->pedestal->push_back(pedcount);
-      mds->n100->push_back( NhitsX(ev, -20, 80) );
-      mds->n400->push_back( NhitsX(ev, -50, 350) );
-      vPed.push_back(pedcount);
+      mds->pedestal.push_back(pedcount);
+      mds->n100.push_back( NhitsX(ev, -20, 80) );
+      mds->n400.push_back( NhitsX(ev, -50, 350) );
+      pedestals.add(pedcount);
+      if( hits != nullptr ) hits->addEV(ev);
       // Fill
     }
     output->Fill();
   }
-  //
-  double avg_pedestal = std::accumulate( vPed.begin(), vPed.end(), 0.0 ) / vPed.size();
-  double std_pedestal = sqrt( std::inner_product( vPed.begin(), vPed.end(), vPed.end(), 0.0 ) / vPed.size() -
-      avg_pedestal*avg_pedestal );
+  output->Close();
+  // NaN for an input without EVs. The quantiles are exact for the
+  // integer pedestal counts, see StreamingStats
+  double avg_pedestal = pedestals.mean();
+  double std_pedestal = pedestals.stddev();
+  double p05 = pedestals.quantile(0.05);
+  double p50 = pedestals.quantile(0.50);
+  double p95 = pedestals.quantile(0.95);
+  double p99 = pedestals.quantile(0.99);
   meta->Branch("AvgPedestal", &avg_pedestal);
   meta->Branch("StdPedestal", &std_pedestal);
+  meta->Branch("PedestalP05", &p05);
+  meta->Branch("PedestalP50", &p50);
+  meta->Branch("PedestalP95", &p95);
+  meta->Branch("PedestalP99", &p99);
   meta->Fill();
 
   otfile->Write(0, TObject::kOverwrite);
+  // Same numbers for either output format, to compare them
+  printf("Wrote %lld rows as %s in %.1f s, file size %lld bytes\n", output->rows,
+      rntuple ? "RNTuple" : "TTree",
+      chrono::duration<double>( chrono::steady_clock::now() - start ).count(),
+      otfile->GetSize());
+  delete output;
+  // Close both files, batches can run through thousands of them
+  delete otfile;
+  T->ResetBranchAddresses();
+  delete tfile;
+  delete ds;
+  delete dsname;
 }
 
 int NhitsX(RAT::DS::EV* ev, double minT, double maxT)
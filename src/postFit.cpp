@@ -15,6 +15,7 @@ using namespace std;
 #include <TH1F.h>
 #include <TH2F.h>
 #include <TChain.h>
+#include <DSBranchSelector.hh>
 // Rat
 #include <RAT/DS/Root.hh>
 #include <RAT/DS/MC.hh>
@@ -48,6 +49,11 @@ int main(int argc, char** argv)
   {
     TChain ch("T");
     ch.Add( (td+"/*").c_str() );
+    // Everything but the centroid and MC tracks
+    DSBranchSelector selector( &ch, DSBranchSelector::EV | DSBranchSelector::PMTs |
+        DSBranchSelector::PathFit | DSBranchSelector::MC | DSBranchSelector::MCParticles |
+        DSBranchSelector::MCPMTs );
+    selector.report();
     ch.SetBranchAddress("ds", &ds);
     // Setup new tree
     string treename = last_dir(td);
@@ -8,6 +8,7 @@
 #include <TTree.h>
 #include <TH1I.h>
 #include <TVector3.h>
+#include <DSBranchSelector.hh>
 
 #include <RAT/DS/Run.hh>
 #include <RAT/DS/Root.hh>
@@ -61,7 +62,12 @@ void prunefile(string iname, string oname, double wallradius, double wallheight)
   dbtree->Branch("ydb", &ydb);
   dbtree->Branch("zdb", &zdb);
 
-  int keep_entries = 0;
+  // The cuts only need the fit and hits; kept events are copied whole in a
+  // second pass, so rejected ones are never fully read
+  DSBranchSelector selector( T, DSBranchSelector::EV | DSBranchSelector::PMTs |
+      DSBranchSelector::PathFit );
+  selector.report();
+  vector<int> keep;
   // Loop through events
   for( int i=0; i < entries; i++ )
   {
@@ -112,9 +118,15 @@ void prunefile(string iname, string oname, double wallradius, double wallheight)
     xdb.push_back( xfirst );
     ydb.push_back( yfirst );
     zdb.push_back( zfirst );
+    keep.push_back( i );
+  }
+  selector.readAll();
+  for( auto i : keep )
+  {
+    T->GetEvent(i);
     output->Fill();
-    keep_entries++;
   }
+  int keep_entries = keep.size();
   dbtree->Fill();
 
   TTree* header = new TTree("header", "header");
@@ -0,0 +1,127 @@
+// Every HitKernels variant the CPU supports against the scalar reference,
+// on the same staged events: window counts and maxima exactly, charge
+// sums to rounding. Run by make test.
+#include <HitKernels.hh>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  int failures = 0;
+
+  void fail( const std::string& isa, int n, const std::string& what )
+  {
+    std::cerr << isa << ", " << n << " hits: " << what << std::endl;
+    failures++;
+  }
+
+  bool close( double a, double b )
+  {
+    return std::fabs( a - b ) <= 1e-12 * std::max( 1.0, std::max( std::fabs(a), std::fabs(b) ) );
+  }
+
+  bool same( const ChargeStats& a, const ChargeStats& b )
+  {
+    return close( a.sum, b.sum ) && close( a.sumsq, b.sumsq ) && a.max == b.max;
+  }
+
+  HitArrays makeEvent( std::mt19937& rng, int n )
+  {
+    std::uniform_real_distribution<float> time( -300, 800 );
+    std::uniform_real_distribution<float> charge( -0.5, 20 );
+    std::uniform_int_distribution<int> type( 0, 3 );
+    HitArrays h;
+    for( int i=0; i < n; i++ )
+    {
+      h.time.push_back( time(rng) );
+      // Some hits without charge, as for noise hits below threshold
+      h.charge.push_back( i % 7 == 0 ? 0.0f : charge(rng) );
+      h.id.push_back( i );
+      h.type.push_back( type(rng) );
+    }
+    // Hits on the window edges are outside
+    if( n > 2 )
+    {
+      h.time[0] = -50;
+      h.time[1] = 350;
+    }
+    return h;
+  }
+}
+
+int main()
+{
+  // The windows of the standard ntuple
+  std::vector<WindowCut> windows = {
+    { -150, -50, 1 }, { -20, 80, 1 }, { -50, 350, 1 }, { -50, 350, 2 }, { -200, 600, 3 } };
+  const int types = 4;
+  std::vector<int> sizes = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 100, 1000, 4099 };
+
+  std::mt19937 rng( 20240601 );
+  std::vector<HitArrays> events;
+  for( int n : sizes )
+    events.push_back( makeEvent( rng, n ) );
+
+  // Reference results
+  HitKernels::select( "scalar" );
+  std::vector<std::vector<int>> refCounts;
+  std::vector<std::vector<ChargeStats>> refStats;
+  for( const HitArrays& h : events )
+  {
+    std::vector<int> counts( windows.size() );
+    std::vector<ChargeStats> stats( types );
+    for( size_t w=0; w < windows.size(); w++ )
+      counts[w] = HitKernels::countWindow( h, windows[w].minT, windows[w].maxT, windows[w].type );
+    for( int t=0; t < types; t++ )
+      stats[t] = HitKernels::chargeStats( h, t );
+    refCounts.push_back( counts );
+    refStats.push_back( stats );
+  }
+
+  const char* variants[] = { "scalar", "sse4.1", "avx2", "avx512f" };
+  for( const char* isa : variants )
+  {
+    if( !HitKernels::select( isa ) )
+    {
+      std::cout << isa << ": not supported by this CPU, skipped" << std::endl;
+      continue;
+    }
+    for( size_t e=0; e < events.size(); e++ )
+    {
+      const HitArrays& h = events[e];
+      int n = h.size();
+      // Stale values from a previous event must not leak through
+      std::vector<int> counts( windows.size(), -1 );
+      ChargeStats junk = { -1, -1, -1 };
+      std::vector<ChargeStats> stats( types, junk );
+      HitKernels::summarize( h, windows, counts, stats );
+      for( size_t w=0; w < windows.size(); w++ )
+      {
+        if( counts[w] != refCounts[e][w] )
+          fail( isa, n, "summarize count of window " + std::to_string(w) );
+        int single = HitKernels::countWindow( h, windows[w].minT, windows[w].maxT, windows[w].type );
+        if( single != refCounts[e][w] )
+          fail( isa, n, "countWindow of window " + std::to_string(w) );
+      }
+      for( int t=0; t < types; t++ )
+      {
+        if( !same( stats[t], refStats[e][t] ) )
+          fail( isa, n, "summarize stats of type " + std::to_string(t) );
+        if( !same( HitKernels::chargeStats( h, t ), refStats[e][t] ) )
+          fail( isa, n, "chargeStats of type " + std::to_string(t) );
+      }
+    }
+    std::cout << isa << ": " << events.size() << " events checked" << std::endl;
+  }
+
+  if( failures > 0 )
+  {
+    std::cerr << failures << " mismatches" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+// MicroDS written to a TTree and read back through SetBranches, into a
+// fresh object and into a copy bound again. Run by make test.
+#include <MicroDS.hh>
+#include <TFile.h>
+#include <TTree.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace
+{
+  int failures = 0;
+
+  void check( bool ok, Long64_t entry, const std::string& what )
+  {
+    if( ok ) return;
+    std::cerr << "entry " << entry << ": " << what << " differs" << std::endl;
+    failures++;
+  }
+
+  // Event i has i particles and 2 i + 1 EVs, so sizes change entry to entry
+  void makeEvent( MicroDS& mds, int i )
+  {
+    mds.cleardata();
+    mds.mcpcount = i;
+    for( int p=0; p < i; p++ )
+    {
+      mds.pdgcodes.push_back( p % 2 ? 11 : -11 );
+      mds.mcKEnergies.push_back( 1.5 * p + i );
+      mds.mcPosx.push_back( p );
+      mds.mcPosy.push_back( -p );
+      mds.mcPosz.push_back( 10 * i );
+      mds.mcDirx.push_back( 1 );
+      mds.mcDiry.push_back( 0 );
+      mds.mcDirz.push_back( 0 );
+    }
+    mds.evcount = 2 * i + 1;
+    for( int e=0; e < mds.evcount; e++ )
+    {
+      mds.subev.push_back( e );
+      mds.triggertime.push_back( 100.0 * e + i );
+      mds.pedestal.push_back( e + i );
+      mds.n100.push_back( 10 * e );
+      mds.n400.push_back( 40 * e );
+      mds.nReal.push_back( 30 * e );
+      mds.x.push_back( e );
+      mds.y.push_back( 2 * e );
+      mds.z.push_back( 3 * e );
+      mds.u.push_back( 0.5 );
+      mds.v.push_back( -0.5 );
+      mds.w.push_back( i );
+    }
+  }
+
+  void compare( const MicroDS& a, const MicroDS& b, Long64_t entry )
+  {
+    check( a.mcpcount == b.mcpcount, entry, "mcpcount" );
+    check( a.pdgcodes == b.pdgcodes, entry, "pdg" );
+    check( a.mcKEnergies == b.mcKEnergies, entry, "mcKEnergy" );
+    check( a.mcPosx == b.mcPosx && a.mcPosy == b.mcPosy && a.mcPosz == b.mcPosz, entry, "mcpos" );
+    check( a.mcDirx == b.mcDirx && a.mcDiry == b.mcDiry && a.mcDirz == b.mcDirz, entry, "mcdir" );
+    check( a.evcount == b.evcount, entry, "evcount" );
+    check( a.subev == b.subev, entry, "subev" );
+    check( a.triggertime == b.triggertime, entry, "triggertime" );
+    check( a.pedestal == b.pedestal && a.n100 == b.n100 && a.n400 == b.n400 && a.nReal == b.nReal,
+        entry, "hit counts" );
+    check( a.x == b.x && a.y == b.y && a.z == b.z, entry, "position" );
+    check( a.u == b.u && a.v == b.v && a.w == b.w, entry, "direction" );
+  }
+}
+
+int main()
+{
+  const int entries = 5;
+  std::string fname = "/tmp/microds_test_" + std::to_string( getpid() ) + ".root";
+
+  TFile* out = new TFile( fname.c_str(), "recreate" );
+  TTree* T = new TTree( "T", "T" );
+  MicroDS written;
+  written.NewBranches( T );
+  for( int i=0; i < entries; i++ )
+  {
+    makeEvent( written, i );
+    T->Fill();
+  }
+  out->Write();
+  delete out;
+
+  TFile* in = new TFile( fname.c_str() );
+  T = (TTree*)in->Get( "T" );
+  MicroDS read;
+  read.SetBranches( T );
+  MicroDS expected;
+  for( Long64_t i=0; i < T->GetEntries(); i++ )
+  {
+    T->GetEntry( i );
+    makeEvent( expected, i );
+    compare( expected, read, i );
+  }
+
+  // A copy holds none of the original's pointers; bound again, it reads
+  // into its own vectors and the original is left alone
+  MicroDS copy = read.clone();
+  copy.SetBranches( T );
+  T->GetEntry( 1 );
+  makeEvent( expected, 1 );
+  compare( expected, copy, 1 );
+  makeEvent( expected, entries - 1 );
+  compare( expected, read, entries - 1 );
+
+  T->ResetBranchAddresses();
+  delete in;
+  remove( fname.c_str() );
+
+  if( failures > 0 )
+  {
+    std::cerr << failures << " mismatches" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "MicroDS round trip over " << entries << " entries" << std::endl;
+  return EXIT_SUCCESS;
+}